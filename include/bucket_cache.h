@@ -0,0 +1,139 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "engine_isa.h"
+
+ENGINE_NAMESPACE_BEGIN
+
+// Fixed-size table of boards to explored depth, memory doesn't grow during search.
+// 4 entries in 64-byte bucket, bucket is selected by board hash.
+// Board itself is not stored, it's verified by the whole 64-bit hash and 32-bit check of board bits.
+// Full bucket replaces entry of older search generation, then entry with the least explored depth.
+struct bucket_cache
+{
+    struct entry_t
+    {
+        uint64_t key;
+        uint32_t check;
+        // explored depth
+        uint16_t depth;
+        // search generation, 0 - empty entry
+        uint16_t age;
+    };
+
+    struct alignas(64) bucket_t
+    {
+        std::array<entry_t, 4> entries;
+    };
+
+    static_assert(sizeof(bucket_t) == 64);
+
+    // the largest power of 2 number of buckets fitting into 'bytes', at least one
+    void resize(size_t bytes)
+    {
+        size_t n = 1;
+        while (n * 2 * sizeof(bucket_t) <= bytes) {
+            n *= 2;
+        }
+        buckets.assign(n, bucket_t{});
+        mask = n - 1;
+        _size = 0;
+    }
+
+    // entries of previous searches are replaced first
+    void new_generation()
+    {
+        age = age == UINT16_MAX ? 1 : age + 1;
+    }
+
+    // insert or get, explored depth of inserted board is 0
+    std::pair<uint16_t*, bool> insert(const std::pair<uint64_t, uint64_t>& brd, uint64_t key)
+    {
+        bucket_t& b = buckets[key & mask];
+        uint32_t c = check(brd);
+
+        entry_t* victim = &b.entries[0];
+        for (entry_t& e : b.entries) {
+            if (e.age != 0 && e.key == key && e.check == c) {
+                e.age = age;
+                return {&e.depth, false};
+            }
+            if (priority(e) < priority(*victim)) {
+                victim = &e;
+            }
+        }
+
+        if (victim->age == 0) {
+            _size++;
+        } else {
+            _replaced++;
+        }
+        *victim = {key, c, 0, age};
+
+        return {&victim->depth, true};
+    }
+
+    size_t size() const
+    {
+        return _size;
+    }
+
+    size_t replaced() const
+    {
+        return _replaced;
+    }
+
+    size_t capacity() const
+    {
+        return buckets.size() * 4;
+    }
+
+    // whole table for checkpoint, see checkpoint.h
+    template<class Writer>
+    void save(Writer& w) const
+    {
+        w.put(age);
+        w.put(_size);
+        w.put(_replaced);
+        w.put_bytes(buckets.data(), buckets.size() * sizeof(bucket_t));
+    }
+
+    // table must be resized to the same size as saved one
+    template<class Reader>
+    void load(Reader& r)
+    {
+        age = r.template get<uint16_t>();
+        _size = r.template get<size_t>();
+        _replaced = r.template get<size_t>();
+        r.get_bytes(buckets.data(), buckets.size() * sizeof(bucket_t));
+    }
+
+    // verification of board in entry, independent of Zobrist keys
+    static uint32_t check(const std::pair<uint64_t, uint64_t>& brd)
+    {
+        uint64_t h = (brd.first * 0x9E3779B97F4A7C15ull) ^ (brd.second * 0xC2B2AE3D27D4EB4Full);
+        return uint32_t(h >> 32);
+    }
+
+private:
+    // empty entry, then old one, then the least deep one
+    int priority(const entry_t& e) const
+    {
+        if (e.age == 0) {
+            return -1;
+        }
+        return (e.age == age ? 1 << 16 : 0) + e.depth;
+    }
+
+    std::vector<bucket_t> buckets{1};
+    size_t mask = 0;
+    uint16_t age = 1;
+    size_t _size = 0;
+    size_t _replaced = 0;
+};
+
+ENGINE_NAMESPACE_END
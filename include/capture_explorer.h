@@ -0,0 +1,198 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include "draughts.h"
+
+ENGINE_NAMESPACE_BEGIN
+
+
+// Capture sequences followed by iterative explorer with explicit stack instead of recursive kernels,
+// the way it was tried instead of kernels. Results are the same as gen_captures() (order may differ),
+// but it's slower for most of positions, so it's not used by search, only by bench and tests.
+template<size_t side_i = 0>
+struct capture_explorer : _board_states_generator<side_i>
+{
+    typedef _board_states_generator<side_i> base_t;
+
+    using base_t::base_t;
+    using base_t::enemy_i;
+    using base_t::cur_state;
+    using base_t::occupied;
+    using base_t::generated;
+    using base_t::chain_src;
+
+    // generator must be prepared, see prepare()
+    size_t gen_captures_iterative()
+    {
+        const board_side_t& player = cur_state.sides[side_i];
+        brd_map_t items = player.items - player.kings;
+        brd_map_t enemies = cur_state.sides[enemy_i].items;
+        brd_map_t empty = ~occupied.mask;
+
+        chain_state = cur_state;
+        chain_occupied = occupied;
+
+        // only simple items with the first jump available, found for whole side at once
+        brd_map_t jumpers = jumpers_of<0>(items, enemies, empty) + jumpers_of<1>(items, enemies, empty)
+                          + jumpers_of<2>(items, enemies, empty) + jumpers_of<3>(items, enemies, empty);
+
+        for (brd_index_t pos : jumpers + player.kings) {
+            chain_src = pos;
+            explore_captures(pos, player.kings.exist(brd_item_t(pos)));
+        }
+
+        return generated;
+    }
+
+    // simple items able to jump in direction 'dir_i'
+    template<size_t dir_i>
+    static brd_map_t jumpers_of(brd_map_t items, brd_map_t enemies, brd_map_t empty)
+    {
+        constexpr size_t back_i = opposite_direction(dir_i);
+        return step<back_i>(step<back_i>(jump<dir_i>(items, enemies, empty)));
+    }
+
+    // Jump of chain piece on square 'pos' in direction 'dir_i', the same as Policy::jump() with runtime square.
+    // King rules are used only for the first jump of king, see king_policy::continuation.
+    template<size_t dir_i>
+    jump_t chain_jump(brd_index_t pos, bool king_rules, brd_map_t may_be_captured) const
+    {
+        if (king_rules) {
+            brd_map_t ray = tables.king_rays[pos.index][dir_i];
+            brd_map_t capture = first_blocker<dir_i>(ray, chain_occupied);
+            if (!may_be_captured.exist_any(capture)) {
+                return {};
+            }
+            brd_map_t behind = ray_beyond<dir_i>(ray, capture);
+            return {capture, ray_before<dir_i>(behind, first_blocker<dir_i>(behind, chain_occupied))};
+        }
+
+        brd_map_t capture = step<dir_i>(brd_map_t(brd_item_t(pos)));
+        if (!may_be_captured.exist_any(capture)) {
+            return {};
+        }
+        brd_map_t dst = step<dir_i>(capture);
+        if (!dst || chain_occupied.exist_any(dst)) {
+            return {};
+        }
+        return {capture, dst};
+    }
+
+    jump_t chain_jump(size_t dir_i, brd_index_t pos, bool king_rules, brd_map_t may_be_captured) const
+    {
+        switch (dir_i) {
+        case 0: return chain_jump<0>(pos, king_rules, may_be_captured);
+        case 1: return chain_jump<1>(pos, king_rules, may_be_captured);
+        case 2: return chain_jump<2>(pos, king_rules, may_be_captured);
+        default: return chain_jump<3>(pos, king_rules, may_be_captured);
+        }
+    }
+
+    // Depth-first walk over capture sequences of piece on square 'src' with explicit stack of jumps,
+    // piece is moved in chain_state and moved back in place, without copies of board.
+    void explore_captures(brd_index_t src, bool king)
+    {
+        board_side_t& player = chain_state.sides[side_i];
+        brd_map_t enemies = chain_state.sides[enemy_i].items;
+
+        size_t top = 0;
+        chain_stack[0] = {src, king, 0, false, {}, {}, {}, {}, {}};
+
+        for (;;) {
+            chain_frame_t& f = chain_stack[top];
+
+            // find next direction with available jump
+            while (!f.dst && f.dir < 4) {
+                jump_t j = chain_jump(f.dir++, f.pos, f.king_rules, enemies - f.captured);
+                f.capture = j.capture;
+                f.dst = j.dst;
+            }
+
+            if (!f.dst) {
+                // nothing more can be captured
+                if (!f.jumped) {
+                    this->save_captured(chain_state, f.pos, f.captured);
+                }
+                if (top == 0) {
+                    return;
+                }
+
+                // undo jump to this square
+                chain_frame_t& prev = chain_stack[--top];
+                player.items ^= prev.undo_items;
+                player.kings ^= prev.undo_kings;
+                chain_occupied ^= prev.undo_items;
+                continue;
+            }
+
+            // do jump to the next destination
+            brd_index_t dst = f.dst.lowest_index();
+            f.dst -= brd_item_t(dst);
+            f.jumped = true;
+
+            brd_map_t moved = brd_map_t(brd_item_t(f.pos)) + brd_item_t(dst);
+            f.undo_items = moved;
+            if (player.kings.exist(brd_item_t(f.pos))) {
+                f.undo_kings = moved;
+            } else {
+                // become new king
+                f.undo_kings = king_row<side_i>.select(brd_map_t(brd_item_t(dst)));
+            }
+            player.items ^= f.undo_items;
+            player.kings ^= f.undo_kings;
+            chain_occupied ^= f.undo_items;
+
+            chain_stack[++top] = {dst, false, 0, false, {}, {}, f.captured + f.capture, {}, {}};
+        }
+    }
+
+    // state of iterative capture sequences explorer
+    struct chain_frame_t
+    {
+        // square of piece, it jumps by king rules only on the first jump of king
+        brd_index_t pos;
+        bool king_rules;
+        // next direction to try, jump destinations left in current direction and enemy captured by them
+        uint8_t dir;
+        bool jumped;
+        brd_map_t dst;
+        brd_map_t capture;
+        // enemies captured before piece came to this square
+        brd_map_t captured;
+        // bits flipped by jump from this square, flipped back on return
+        brd_map_t undo_items;
+        brd_map_t undo_kings;
+    };
+
+    board_state_t chain_state;
+    brd_map_t chain_occupied;
+    // every jump captures different enemy piece, so sequence is shorter than number of squares
+    std::array<chain_frame_t, 32> chain_stack;
+};
+
+
+// sorted results of capture sequences, by iterative explorer or recursive kernels
+template<size_t side_i>
+std::vector<std::pair<uint64_t, uint64_t>> sorted_captures(const board_state_t& brd, bool iterative)
+{
+    std::vector<board_state_t> states;
+    capture_explorer<side_i> g(states);
+    g.prepare(brd);
+    if (iterative) {
+        g.gen_captures_iterative();
+    } else {
+        g.gen_captures();
+    }
+
+    std::vector<std::pair<uint64_t, uint64_t>> r;
+    for (const auto& b : states) {
+        r.push_back(std::pair<uint64_t, uint64_t>(b));
+    }
+    std::sort(r.begin(), r.end());
+    return r;
+}
+
+ENGINE_NAMESPACE_END
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <type_traits>
+
+#include <unistd.h>
+
+#include "engine_isa.h"
+
+ENGINE_NAMESPACE_BEGIN
+
+// Binary checkpoint of search state: values are read back in the same order they were written,
+// see DFS::save() and DFS::load(). Checkpoint is valid only for the same build.
+// Values are streamed to and from file, large tables (see bucket_cache) are not copied in memory.
+
+inline constexpr char checkpoint_magic[8] = {'D', 'T', 'S', 'C', 'K', 'P', 'T', '1'};
+
+struct checkpoint_error : std::runtime_error
+{
+    using std::runtime_error::runtime_error;
+};
+
+// New file is written next to the old one and renamed over it by commit(),
+// so checkpoint file is always either old or new one, even after crash.
+struct checkpoint_writer
+{
+    explicit checkpoint_writer(const std::string& path) :
+        path(path),
+        tmp(path + ".tmp"),
+        f(fopen(tmp.c_str(), "wb"))
+    {
+        if (!f) {
+            throw checkpoint_error("can't write checkpoint " + tmp);
+        }
+        write(checkpoint_magic, sizeof(checkpoint_magic));
+    }
+
+    checkpoint_writer(const checkpoint_writer&) = delete;
+    checkpoint_writer& operator=(const checkpoint_writer&) = delete;
+
+    // not committed checkpoint is discarded
+    ~checkpoint_writer()
+    {
+        if (f) {
+            fclose(f);
+            remove(tmp.c_str());
+        }
+    }
+
+    template<class T>
+    void put(const T& v)
+    {
+        static_assert(std::is_trivially_copyable<T>::value);
+        write(&v, sizeof(v));
+    }
+
+    void put_bytes(const void* p, size_t n)
+    {
+        put(n);
+        write(p, n);
+    }
+
+    template<class T>
+    void put_vector(const std::vector<T>& v)
+    {
+        static_assert(std::is_trivially_copyable<T>::value);
+        put(v.size());
+        write(v.data(), v.size() * sizeof(T));
+    }
+
+    void put_string(const std::string& s)
+    {
+        put_bytes(s.data(), s.size());
+    }
+
+    void commit()
+    {
+        ok = fflush(f) == 0 && ok;
+        ok = fsync(fileno(f)) == 0 && ok;
+        ok = fclose(f) == 0 && ok;
+        f = nullptr;
+
+        if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+            remove(tmp.c_str());
+            throw checkpoint_error("can't write checkpoint " + path);
+        }
+    }
+
+private:
+    // errors are checked once on commit
+    void write(const void* p, size_t n)
+    {
+        ok = fwrite(p, 1, n, f) == n && ok;
+    }
+
+    std::string path;
+    std::string tmp;
+    FILE* f;
+    bool ok = true;
+};
+
+struct checkpoint_reader
+{
+    explicit checkpoint_reader(const std::string& path) :
+        f(fopen(path.c_str(), "rb"))
+    {
+        if (!f) {
+            throw checkpoint_error("can't open checkpoint " + path);
+        }
+        char magic[sizeof(checkpoint_magic)] = {};
+        if (fread(magic, 1, sizeof(magic), f) != sizeof(magic) || memcmp(magic, checkpoint_magic, sizeof(magic)) != 0) {
+            fclose(f);
+            throw checkpoint_error("not a checkpoint file: " + path);
+        }
+    }
+
+    checkpoint_reader(const checkpoint_reader&) = delete;
+    checkpoint_reader& operator=(const checkpoint_reader&) = delete;
+
+    ~checkpoint_reader()
+    {
+        fclose(f);
+    }
+
+    template<class T>
+    T get()
+    {
+        static_assert(std::is_trivially_copyable<T>::value);
+        T v;
+        read(&v, sizeof(T));
+        return v;
+    }
+
+    void get_bytes(void* p, size_t n)
+    {
+        if (get<size_t>() != n) {
+            throw checkpoint_error("checkpoint doesn't match search configuration");
+        }
+        read(p, n);
+    }
+
+    template<class T>
+    std::vector<T> get_vector()
+    {
+        static_assert(std::is_trivially_copyable<T>::value);
+        std::vector<T> v(get<size_t>());
+        read(v.data(), v.size() * sizeof(T));
+        return v;
+    }
+
+    std::string get_string()
+    {
+        std::string s(get<size_t>(), '\0');
+        read(s.data(), s.size());
+        return s;
+    }
+
+private:
+    void read(void* p, size_t n)
+    {
+        if (fread(p, 1, n, f) != n) {
+            throw checkpoint_error("checkpoint file is truncated");
+        }
+    }
+
+    FILE* f;
+};
+
+ENGINE_NAMESPACE_END
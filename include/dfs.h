@@ -1,17 +1,19 @@
 #pragma once
 
 #include <chrono>
-#include <unordered_set>
+#include <unordered_map>
 #include <random>
 #include <numeric>
 
-#include <boost/functional/hash.hpp>
-
-#include <google/dense_hash_set>
+#include <google/dense_hash_map>
 
 #include "draughts.h"
 #include "utils.h"
-#include "judy_128_set.h"
+#include "judy_128_map.h"
+#include "bucket_cache.h"
+#include "checkpoint.h"
+
+ENGINE_NAMESPACE_BEGIN
 
 using Clock = std::chrono::system_clock;
 
@@ -53,14 +55,42 @@ struct stats
         }
     }
 
+    void cache_lookup()
+    {
+        cache_lookups++;
+    }
+
     void cache_hit()
     {
         cache_hits++;
     }
 
-    void depth_limit()
+    void cache_replacements(size_t n)
+    {
+        cache_replaced = n;
+    }
+
+    void cache_reexpand()
+    {
+        cache_reexpands++;
+    }
+
+    void depth_limit(size_t n = 1)
+    {
+        depth_limits += n;
+    }
+
+    void chain_cache_usage(const chain_cache_t& cache)
+    {
+        chain_cache_lookups = cache.lookups;
+        chain_cache_hits = cache.hits;
+    }
+
+    // counters of search loaded from checkpoint are continued by new cache
+    void restore_chain_cache_usage(chain_cache_t& cache) const
     {
-        depth_limits++;
+        cache.lookups = chain_cache_lookups;
+        cache.hits = chain_cache_hits;
     }
 
     void print(Clock::time_point started, size_t j)
@@ -79,7 +109,17 @@ struct stats
         }
         printf("\n");
 
-        printf("W wins: %lu; B wins: %lu; depth limits: %lu; cache hits: %lu\n", w_wins, b_wins, depth_limits, cache_hits);
+        printf("W wins: %lu; B wins: %lu; depth limits: %lu; cache hits: %lu; cache re-expanded: %lu\n",
+               w_wins, b_wins, depth_limits, cache_hits, cache_reexpands);
+
+        if (cache_lookups > 0) {
+            printf("cache hit rate: %.2f%%; cache replaced: %lu\n", 100.0 * cache_hits / cache_lookups, cache_replaced);
+        }
+
+        if (chain_cache_lookups > 0) {
+            printf("capture chains cache: lookups: %lu; hits: %.2f%%\n",
+                   chain_cache_lookups, 100.0 * chain_cache_hits / chain_cache_lookups);
+        }
     }
 
     size_t total_boards() const
@@ -87,13 +127,68 @@ struct stats
         return _total_boards;
     }
 
+    size_t reexpanded() const
+    {
+        return cache_reexpands;
+    }
+
+    friend bool operator==(const stats& lhs, const stats& rhs)
+    {
+        return lhs._total_boards == rhs._total_boards
+            && lhs.level_width_hist == rhs.level_width_hist
+            && lhs.w_wins == rhs.w_wins
+            && lhs.b_wins == rhs.b_wins
+            && lhs.depth_limits == rhs.depth_limits
+            && lhs.cache_lookups == rhs.cache_lookups
+            && lhs.cache_hits == rhs.cache_hits
+            && lhs.cache_reexpands == rhs.cache_reexpands
+            && lhs.cache_replaced == rhs.cache_replaced
+            && lhs.chain_cache_lookups == rhs.chain_cache_lookups
+            && lhs.chain_cache_hits == rhs.chain_cache_hits;
+    }
+
+    void save(checkpoint_writer& w) const
+    {
+        w.put(_total_boards);
+        w.put_vector(level_width_hist);
+        w.put(w_wins);
+        w.put(b_wins);
+        w.put(depth_limits);
+        w.put(cache_lookups);
+        w.put(cache_hits);
+        w.put(cache_reexpands);
+        w.put(cache_replaced);
+        w.put(chain_cache_lookups);
+        w.put(chain_cache_hits);
+    }
+
+    void load(checkpoint_reader& r)
+    {
+        _total_boards = r.get<size_t>();
+        level_width_hist = r.get_vector<size_t>();
+        w_wins = r.get<size_t>();
+        b_wins = r.get<size_t>();
+        depth_limits = r.get<size_t>();
+        cache_lookups = r.get<size_t>();
+        cache_hits = r.get<size_t>();
+        cache_reexpands = r.get<size_t>();
+        cache_replaced = r.get<size_t>();
+        chain_cache_lookups = r.get<size_t>();
+        chain_cache_hits = r.get<size_t>();
+    }
+
     stats& operator+=(stats& other)
     {
         _total_boards += other._total_boards;
         w_wins += other.w_wins;
         b_wins += other.b_wins;
         depth_limits += other.depth_limits;
+        cache_lookups += other.cache_lookups;
         cache_hits += other.cache_hits;
+        cache_replaced += other.cache_replaced;
+        cache_reexpands += other.cache_reexpands;
+        chain_cache_lookups += other.chain_cache_lookups;
+        chain_cache_hits += other.chain_cache_hits;
 
         if (other.level_width_hist.size() > level_width_hist.size()) {
             level_width_hist.resize(other.level_width_hist.size(), 0);
@@ -119,14 +214,42 @@ private:
     size_t w_wins = 0;
     size_t b_wins = 0;
     size_t depth_limits = 0;
+    size_t cache_lookups = 0;
     size_t cache_hits = 0;
+    size_t cache_reexpands = 0;
+    size_t cache_replaced = 0;
+    size_t chain_cache_lookups = 0;
+    size_t chain_cache_hits = 0;
 };
 
 
 
-using dense_cache = google::dense_hash_set<std::pair<uint64_t, uint64_t>, boost::hash<std::pair<uint64_t, uint64_t>>>;
-using judy_cache = judy_128_set;
-using std_cache = std::unordered_set<std::pair<uint64_t, uint64_t>, boost::hash<std::pair<uint64_t, uint64_t>>>;
+// Board in hash map cache, Zobrist key of board is used as hash value as is.
+struct cached_board_t
+{
+    std::pair<uint64_t, uint64_t> brd;
+    uint64_t key;
+
+    friend bool operator==(const cached_board_t& lhs, const cached_board_t& rhs)
+    {
+        return lhs.brd == rhs.brd;
+    }
+};
+
+struct zobrist_hash
+{
+    size_t operator()(const cached_board_t& b) const
+    {
+        return b.key;
+    }
+};
+
+// Transposition table: board -> depth of tree explored under the board (remaining depth when visited).
+using dense_cache = google::dense_hash_map<cached_board_t, size_t, zobrist_hash>;
+using judy_cache = judy_128_map;
+using std_cache = std::unordered_map<cached_board_t, size_t, zobrist_hash>;
+// bounded by search_config_t::cache_mb
+using bounded_cache = bucket_cache;
 
 inline bool g_running = true;
 
@@ -138,6 +261,18 @@ struct search_config_t
     size_t max_width = 0;
     bool randomize = false;
     bool cache = false;
+    // generate successors one at a time, see lazy_moves_t
+    bool lazy = false;
+    // memoize capture sequences of pieces, see chain_cache_t
+    bool chain_cache = false;
+    // single board changed by moves in place and restored back, see make_move()
+    bool in_place = false;
+    // explicit stack of frames instead of recursion, see run_iterative()
+    bool iterative = false;
+    // size of bounded_cache
+    size_t cache_mb = 256;
+    // bounded_cache is saved into checkpoint, see DFS::save()
+    bool checkpoint_cache = false;
 };
 
 
@@ -155,30 +290,40 @@ struct DFS
     :
         max_depth(cfg.max_depth),
         randomize(cfg.randomize),
+        lazy(cfg.lazy),
+        enable_chain_cache(cfg.chain_cache),
+        in_place(cfg.in_place),
+        iterative(cfg.iterative),
         max_width(cfg.max_width),
-        verbose(verbose),
+        // workers of MTDFS never print boards, so verbose must not disable bulk counting and status step
+        verbose(single_thread && verbose),
         run_until(cfg.run_until),
         stack(cfg.max_depth),
         enable_cache(cfg.cache),
+        checkpoint_cache(cfg.checkpoint_cache),
         print_win_path(print_win_path),
         print_cache_hit_board(print_cache_hit_board),
         brd_callback(brd_callback)
     {
-        std::mt19937 rng{std::random_device{}()};
-        for (size_t i = 0; i < MAX_LEVEL_WIDTH; i++) {
-            std::vector<size_t> v(i);
-            std::iota(v.begin(), v.end(), 0);
-            std::shuffle(v.begin(), v.end(), rng);
-            random_indexes.emplace_back(std::move(v));
-        }
+        gen_random_indexes(std::random_device{}());
 
         path.reserve(max_depth);
+        line.reserve(max_depth);
+        frames.resize(max_depth + 1);
 
         if constexpr (std::is_same<Cache, dense_cache>::value) {
-            boards_cache.set_empty_key({0, 0});
+            boards_cache.set_empty_key({{0, 0}, 0});
         }
+        if constexpr (std::is_same<Cache, bounded_cache>::value) {
+            if (enable_cache) {
+                boards_cache.resize(cfg.cache_mb << 20);
+            }
+        }
+
+        // leaves are only counted if nothing is done with them individually
+        bulk_count_leaves = !this->verbose && !print_win_path && !enable_cache && !brd_callback && max_width == 0;
 
-        if (verbose || print_win_path || print_cache_hit_board) {
+        if (this->verbose || print_win_path || print_cache_hit_board) {
             boards_count_step = 1;
         } else {
             boards_count_step = 1000000;
@@ -187,16 +332,7 @@ struct DFS
 
     dfs_result_t do_search(const board_state_t& brd)
     {
-        auto tp = Clock::to_time_t(run_until);
-        std::cout << std::boolalpha
-                  << "DFS, max_depth=" << max_depth
-                  << ", run_until=" << std::put_time(std::localtime(&tp), "%F %T") 
-                  << ", max_width=" << max_width
-                  << ", randomize=" << randomize
-                  << ", cache=" << enable_cache 
-                  << ", print_cache_hits=" << print_cache_hit_board
-                  << ", print_wins=" << print_win_path
-                  << std::endl;
+        print_config();
 
         printf("\n  Initial board:\n");
         print(brd);
@@ -205,32 +341,56 @@ struct DFS
         started = Clock::now();
         next_status_print = started + status_print_period;
         next_total_boards = boards_count_step;
+        next_checkpoint = started + checkpoint_period;
         sts = std::move(stats());
         if (print_win_path) {
             path.clear();
+            line.clear();
         }
 
-        _search_r(stack.data(), brd, 0);
-
-        sts.print(started, 1);
-        if (enable_cache) {
-            printf("\nCached: %lu boards", boards_cache.size());
-            if (max_width > 0) {
-                printf("\n");
-            } else {
-                printf(", Hits: %.2f%%\n", 100.0*(sts.total_boards() - boards_cache.size())/sts.total_boards());
-            }
+        attach_chain_cache();
+        new_cache_generation();
+        if (iterative) {
+            set_roots({brd}, 0);
+            search_roots();
+        } else {
+            search_root<0>(brd, 0);
         }
+        sts.chain_cache_usage(chain_cache);
+        collect_cache_stats();
+
+        print_results();
+
+        return {sts, running};
+    }
+
+    // continue search loaded from checkpoint, see load()
+    dfs_result_t resume()
+    {
+        print_config();
+        printf("\nResumed: %lu boards, %.0fs elapsed before\n", sts.total_boards(), total_seconds(elapsed_before));
+
+        next_status_print = Clock::now() + status_print_period;
+        continue_search();
+
+        print_results();
 
         return {sts, running};
     }
 
+    // the same as do_search() without printing
     dfs_result_t _do_search(const board_state_t& brd)
     {
         running = true;
+        started = Clock::now();
+        next_status_print = started + status_print_period;
         next_total_boards = boards_count_step;
 
-        _search_r(stack.data(), brd, 0);
+        attach_chain_cache();
+        new_cache_generation();
+        search_root<0>(brd, 0);
+        sts.chain_cache_usage(chain_cache);
+        collect_cache_stats();
 
         return {sts, running};
     }
@@ -239,15 +399,145 @@ struct DFS
     dfs_result_t do_search(const std::vector<board_state_t>& boards, size_t depth)
     {
         running = true;
+        started = Clock::now();
+        next_status_print = started + status_print_period;
         next_total_boards = boards_count_step;
+        next_checkpoint = started + checkpoint_period;
+
+        attach_chain_cache();
+        new_cache_generation();
 
-        for (const auto& brd : boards) {
-            _search_r(stack.data(), brd, depth);
+        if (iterative) {
+            set_roots(boards, depth);
+            search_roots();
+        } else {
+            // boards are in absolute orientation, even depth - white moves
+            for (const auto& brd : boards) {
+                if (depth % 2 == 0) {
+                    search_root<0>(brd, depth);
+                } else {
+                    search_root<1>(brd, depth);
+                }
+            }
         }
+        sts.chain_cache_usage(chain_cache);
+        collect_cache_stats();
 
         return {sts, running};
     }
 
+    // Boards of iterative search are set, but search is not started, see continue_search().
+    // Even depth - white moves.
+    void set_roots(const std::vector<board_state_t>& boards, size_t depth)
+    {
+        roots = boards;
+        next_root = 0;
+        root_depth = depth;
+        levels = 0;
+        pending = false;
+        elapsed_before = {};
+    }
+
+    // iterative search of boards set by set_roots() or load(), return stats and completion flag
+    dfs_result_t continue_search()
+    {
+        running = true;
+        // elapsed time is saved into checkpoint
+        started = Clock::now() - elapsed_before;
+        next_total_boards = sts.total_boards() + boards_count_step;
+        next_checkpoint = Clock::now() + checkpoint_period;
+
+        attach_chain_cache();
+        search_roots();
+        sts.chain_cache_usage(chain_cache);
+        collect_cache_stats();
+
+        return {sts, running};
+    }
+
+    // Iterative search only: 'write' is called periodically from search thread,
+    // when search state is consistent and can be saved with save().
+    void set_checkpoint(std::function<void()> write, Clock::duration period)
+    {
+        checkpoint = std::move(write);
+        checkpoint_period = period;
+    }
+
+    // Iterative search state: boards of search, frames of current one, stats and optionally cache.
+    // Moves of frames are not saved, they are generated again on load.
+    void save(checkpoint_writer& w) const
+    {
+        w.put(seed);
+        w.put(Clock::now() - started);
+        sts.save(w);
+
+        w.put_vector(roots);
+        w.put(next_root);
+        w.put(root_depth);
+        w.put(levels);
+        w.put(pending);
+        for (size_t level = 0; level < levels + pending; level++) {
+            w.put(frames[level].brd.state);
+            w.put(frames[level].next);
+        }
+
+        bool with_cache = false;
+        if constexpr (std::is_same<Cache, bounded_cache>::value) {
+            with_cache = enable_cache && checkpoint_cache;
+        }
+        w.put(with_cache);
+        if constexpr (std::is_same<Cache, bounded_cache>::value) {
+            if (with_cache) {
+                boards_cache.save(w);
+            }
+        }
+    }
+
+    // search configuration must be the same as of saved one
+    void load(checkpoint_reader& r)
+    {
+        gen_random_indexes(r.get<uint32_t>());
+        elapsed_before = r.get<Clock::duration>();
+        started = Clock::now() - elapsed_before;
+        sts.load(r);
+        // entries of chain cache are not saved, it starts empty
+        sts.restore_chain_cache_usage(chain_cache);
+
+        roots = r.get_vector<board_state_t>();
+        next_root = r.get<size_t>();
+        root_depth = r.get<size_t>();
+        levels = r.get<size_t>();
+        pending = r.get<bool>();
+        if (levels + pending > frames.size()) {
+            throw checkpoint_error("checkpoint doesn't match search configuration");
+        }
+        path.clear();
+        for (size_t level = 0; level < levels + pending; level++) {
+            frames[level].brd = keyed_board_t(r.get<board_state_t>());
+            frames[level].next = r.get<size_t>();
+        }
+        for (size_t level = 0; level < levels; level++) {
+            frame_t& f = frames[level];
+            const move_list_t& v = (root_depth + level) % 2 == 0 ? stack[level].template gen_next_moves<0>(f.brd.state)
+                                                                 : stack[level].template gen_next_moves<1>(f.brd.state);
+            f.moves = &v;
+            f.count = branches_count(v.size());
+            if (print_win_path) {
+                path.push_back(f.brd.state);
+            }
+        }
+
+        if (r.get<bool>()) {
+            if constexpr (std::is_same<Cache, bounded_cache>::value) {
+                if (enable_cache) {
+                    boards_cache.load(r);
+                    return;
+                }
+            }
+            throw checkpoint_error("checkpoint doesn't match search configuration");
+        }
+    }
+
     auto get_callable(std::vector<board_state_t>&& boards, size_t depth)
     {
         return [b{std::forward<std::vector<board_state_t>>(boards)}, this, depth] () {
@@ -255,7 +545,107 @@ struct DFS
         };
     }
 
+    auto get_continue_callable()
+    {
+        return [this] () {
+            return continue_search();
+        };
+    }
+
 private:
+    // board on the path of iterative search
+    struct frame_t
+    {
+        keyed_board_t brd;
+        const move_list_t* moves;
+        // number of branches to visit and the next one
+        size_t count;
+        size_t next;
+    };
+
+    void gen_random_indexes(uint32_t s)
+    {
+        seed = s;
+        std::mt19937 rng{seed};
+        random_indexes.clear();
+        for (size_t i = 0; i < MAX_LEVEL_WIDTH; i++) {
+            std::vector<size_t> v(i);
+            std::iota(v.begin(), v.end(), 0);
+            std::shuffle(v.begin(), v.end(), rng);
+            random_indexes.emplace_back(std::move(v));
+        }
+    }
+
+    void print_config()
+    {
+        auto tp = Clock::to_time_t(run_until);
+        std::cout << std::boolalpha
+                  << "DFS, max_depth=" << max_depth
+                  << ", run_until=" << std::put_time(std::localtime(&tp), "%F %T") 
+                  << ", max_width=" << max_width
+                  << ", randomize=" << randomize
+                  << ", lazy=" << lazy
+                  << ", chain_cache=" << enable_chain_cache
+                  << ", in_place=" << in_place
+                  << ", iterative=" << iterative
+                  << ", cache=" << enable_cache 
+                  << ", print_cache_hits=" << print_cache_hit_board
+                  << ", print_wins=" << print_win_path
+                  << std::endl;
+    }
+
+    void print_results()
+    {
+        sts.print(started, 1);
+        if (enable_cache) {
+            printf("\nCached: %lu boards", boards_cache.size());
+            if constexpr (std::is_same<Cache, bounded_cache>::value) {
+                // boards are replaced, see cache hit rate above
+                printf(" of %lu\n", boards_cache.capacity());
+            } else if (max_width > 0) {
+                printf("\n");
+            } else {
+                printf(", Hits: %.2f%%\n", 100.0*(sts.total_boards() - boards_cache.size())/sts.total_boards());
+            }
+        }
+    }
+
+    // cache is owned by search object, that can be copied (see MTDFS), so generators are attached on start
+    void attach_chain_cache()
+    {
+        for (auto& g : stack) {
+            g.set_chain_cache(enable_chain_cache ? &chain_cache : nullptr);
+        }
+    }
+
+    // entries of previous searches are replaced first
+    void new_cache_generation()
+    {
+        if constexpr (std::is_same<Cache, bounded_cache>::value) {
+            boards_cache.new_generation();
+        }
+    }
+
+    void collect_cache_stats()
+    {
+        if constexpr (std::is_same<Cache, bounded_cache>::value) {
+            sts.cache_replacements(boards_cache.replaced());
+        }
+    }
+
+    template<size_t side_i>
+    void search_root(const board_state_t& brd, size_t depth)
+    {
+        if (in_place) {
+            root = brd;
+            root_depth = depth;
+            board = keyed_board_t(brd);
+            _search_in_place<side_i>(stack.data(), depth);
+        } else {
+            _search_r<side_i>(stack.data(), keyed_board_t(brd), depth);
+        }
+    }
+
     void handle_status()
     {
         if (sts.total_boards() < next_total_boards) {
@@ -273,6 +663,10 @@ private:
 
         running = Clock::now() < run_until;
 
+        if (checkpoint && Clock::now() >= next_checkpoint) {
+            checkpoint_due = true;
+        }
+
         if constexpr (single_thread) {
             if (!running) {
                 printf("Timeout.\n");
@@ -285,66 +679,194 @@ private:
     void print_board(const board_state_t& brd, size_t depth, size_t branch)
     {
         printf("\n  depth: %lu; branch: %lu:\n", depth, branch);
-        if (depth % 2 == 0) {
-            print(rotate(brd));
-        } else {
-            print(brd);
-        }
+        print(brd);
     }
 
     void print_board(const board_state_t& brd, size_t depth)
     {
         printf("\n  depth: %lu;\n", depth);
-        if (depth % 2 == 0) {
-            print(rotate(brd));
+        print(brd);
+    }
+
+    // key is kept up to date only for cache
+    template<size_t side_i>
+    keyed_board_t next_board(const keyed_board_t& brd, const move_t& m) const
+    {
+        if (enable_cache) {
+            return apply<side_i>(brd, m);
+        }
+        return {apply<side_i>(brd.state, m), 0};
+    }
+
+    // insert or get, pointer to explored depth and if board is new
+    auto cache_insert(const keyed_board_t& b)
+    {
+        if constexpr (std::is_same<Cache, judy_cache>::value) {
+            // judy is a tree of full board bits, hash is not needed
+            return boards_cache.insert(std::pair<uint64_t, uint64_t>(b.state));
+        } else if constexpr (std::is_same<Cache, bounded_cache>::value) {
+            return boards_cache.insert(std::pair<uint64_t, uint64_t>(b.state), b.key);
         } else {
-            print(brd);
+            auto r = boards_cache.insert({{std::pair<uint64_t, uint64_t>(b.state), b.key}, 0});
+            return std::pair<size_t*, bool>(&r.first->second, r.second);
         }
     }
 
-    void _handle_brd(board_states_generator* sp, const board_state_t& brd, size_t depth, size_t branch)
+    void print_win(const board_state_t& brd, size_t depth)
     {
         if constexpr (single_thread) {
-            if (verbose) {
-                print_board(brd, depth, branch);
+            if (print_win_path) {
+                printf("%s WINS:\n", (depth % 2) ? "B" : "W");
+                size_t d = 0;
+                for (const auto& b : path) {
+                    print_board(b, d++);
+                }
+                print_board(brd, depth);
+                printf("%s WINS!\n\n", (depth % 2) ? "B" : "W");
             }
         }
+    }
 
-        if (enable_cache) {
-            auto ins_res = boards_cache.insert(std::pair<uint64_t, uint64_t>(brd));
-            if (!ins_res.second) {
-                sts.cache_hit();
-                if constexpr (single_thread) {
-                    if (print_cache_hit_board) {
-                        printf("LOOP:\n");
-                        print_board(brd, depth);
-                    }
+    // path of in-place search is replayed from moves
+    void print_win_line(size_t depth)
+    {
+        if constexpr (single_thread) {
+            if (print_win_path) {
+                printf("%s WINS:\n", (depth % 2) ? "B" : "W");
+                board_state_t b = root;
+                size_t d = root_depth;
+                for (const auto& m : line) {
+                    print_board(b, d);
+                    b = (d++ % 2 == 0) ? apply<0>(b, m) : apply<1>(b, m);
                 }
-                return;
+                print_board(b, depth);
+                printf("%s WINS!\n\n", (depth % 2) ? "B" : "W");
+            }
+        }
+    }
+
+    // Board is already visited with at least the same remaining depth, so the tree under it is explored.
+    // Otherwise board is stored with remaining depth and has to be expanded (again, if it was visited deeper).
+    template<size_t side_i>
+    bool cached(const keyed_board_t& brd, size_t depth)
+    {
+        // key is board from the point of view of the side that made the move,
+        // so symmetric positions of white and black are the same cache entry
+        keyed_board_t key = side_i == 1 ? brd : rotate(brd);
+        sts.cache_lookup();
+        auto [explored, inserted] = cache_insert(key);
+        if (!explored) {
+            // out of memory, board is not stored
+            return false;
+        }
+
+        size_t remaining = max_depth - depth;
+        if (inserted || *explored < remaining) {
+            if (!inserted) {
+                sts.cache_reexpand();
+            }
+            *explored = remaining;
+            return false;
+        }
+
+        sts.cache_hit();
+        if constexpr (single_thread) {
+            if (print_cache_hit_board) {
+                printf("LOOP:\n");
+                print_board(brd.state, depth);
+            }
+        }
+        return true;
+    }
+
+    // Number of visited branches of level of n > 0 moves: all or max_width of them.
+    // Without randomize limited branches are the first, the middle (max_width=3) and the last one.
+    size_t branches_count(size_t n) const
+    {
+        if (max_width == 0) {
+            return n;
+        }
+        if (randomize) {
+            return std::min(max_width, n);
+        }
+        return 1 + (max_width == 3 && n >= 3) + (max_width >= 2 && n >= 2);
+    }
+
+    // index of move of k-th visited branch
+    size_t branch(size_t k, size_t n) const
+    {
+        if (randomize) {
+            return random_indexes[n][k];
+        }
+        if (max_width == 0 || k == 0) {
+            return k;
+        }
+        if (k == 1 && max_width == 3 && n >= 3) {
+            return n / 2;
+        }
+        return n - 1;
+    }
+
+    // 'visit' is called with index of move of every visited branch in order
+    template<class F>
+    void for_each_branch(size_t n, F&& visit)
+    {
+        size_t count = branches_count(n);
+        for (size_t k = 0; k < count; k++) {
+            visit(branch(k, n));
+        }
+    }
+
+    // board after move of side 1 - side_i, side_i is going to move next
+    template<size_t side_i>
+    void _handle_brd(moves_generator* sp, const keyed_board_t& brd, size_t depth, size_t branch)
+    {
+        if constexpr (single_thread) {
+            if (verbose) {
+                print_board(brd.state, depth, branch);
             }
         }
 
+        if (enable_cache && cached<side_i>(brd, depth)) {
+            return;
+        }
+
         if (depth < max_depth) {
-            _search_r(sp, rotate(brd), depth);
+            _search_r<side_i>(sp, brd, depth);
         } else {
             sts.depth_limit();
         }
     }
 
-    void _search_r(board_states_generator* sp, const board_state_t& brd, size_t depth)
+    template<size_t side_i>
+    void _search_r(moves_generator* sp, const keyed_board_t& brd, size_t depth)
     {
         handle_status();
         if (!running) {
             return;
         }
 
-        auto& v = sp->gen_next_states(brd);
+        if (bulk_count_leaves && depth + 1 == max_depth) {
+            // every next board is a leaf at depth limit
+            size_t n = sp->template count_next_moves<side_i>(brd.state);
+            sts.consume_level_width(n, depth);
+            sts.depth_limit(n);
+            return;
+        }
+
+        if (lazy) {
+            _search_lazy<side_i>(sp, brd, depth);
+            return;
+        }
+
+        // only boards visited below are materialized from moves
+        auto& v = sp->template gen_next_moves<side_i>(brd.state);
         sts.consume_level_width(v.size(), depth);
 
         if constexpr (single_thread) {
             if (brd_callback && v.size() > 0) {
-                for (const auto& b : v) {
-                    running = brd_callback((depth % 2) ? rotate(b) : b, depth + 1);
+                for (const auto& m : v) {
+                    running = brd_callback(apply<side_i>(brd.state, m), depth + 1);
                     if (!running) {
                         break;
                     }
@@ -353,17 +875,7 @@ private:
         }
 
         if (v.size() == 0) {
-            if constexpr (single_thread) {
-                if (print_win_path) {
-                    printf("%s WINS:\n", (depth % 2) ? "B" : "W");
-                    size_t d = 0;
-                    for (const auto& b : path) {
-                        print_board(b, d++);
-                    }
-                    print_board(brd, depth);
-                    printf("%s WINS!\n\n", (depth % 2) ? "B" : "W");
-                }
-            }
+            print_win(brd.state, depth);
             return;
         }
 
@@ -373,49 +885,295 @@ private:
 
         if constexpr (single_thread) {
             if (print_win_path) {
-                path.push_back(brd);
+                path.push_back(brd.state);
             }
         }
 
-        if (max_width == 0) {
-            if (randomize) {
-                // Iterate all branches in random order
+        for_each_branch(v.size(), [&] (size_t i) {
+            _handle_brd<1 - side_i>(sp, next_board<side_i>(brd, v[i]), depth, i);
+        });
+
+        if constexpr (single_thread) {
+            if (print_win_path) {
+                path.pop_back();
+            }
+        }
+    }
+
+    // board after move of side 1 - side_i is in 'board', side_i is going to move next
+    template<size_t side_i>
+    void _handle_in_place(moves_generator* sp, size_t depth, size_t branch)
+    {
+        if constexpr (single_thread) {
+            if (verbose) {
+                print_board(board.state, depth, branch);
+            }
+        }
+
+        if (enable_cache && cached<side_i>(board, depth)) {
+            return;
+        }
+
+        if (depth < max_depth) {
+            _search_in_place<side_i>(sp, depth);
+        } else {
+            sts.depth_limit();
+        }
+    }
+
+    // The same as _search_r(), but there is single board, changed by move before going deeper
+    // and restored after, so only list of moves is kept per depth.
+    // Key of board is kept up to date only for cache.
+    template<size_t side_i>
+    void _search_in_place(moves_generator* sp, size_t depth)
+    {
+        handle_status();
+        if (!running) {
+            return;
+        }
+
+        if (bulk_count_leaves && depth + 1 == max_depth) {
+            size_t n = sp->template count_next_moves<side_i>(board.state);
+            sts.consume_level_width(n, depth);
+            sts.depth_limit(n);
+            return;
+        }
 
-                const auto& indexes = random_indexes[v.size()];
-                for (size_t i = 0; i < v.size(); i++) {
-                    size_t index = indexes[i];
-                    _handle_brd(sp, v[index], depth, index);
+        auto& v = sp->template gen_next_moves<side_i>(board.state);
+        sts.consume_level_width(v.size(), depth);
+
+        if constexpr (single_thread) {
+            if (brd_callback && v.size() > 0) {
+                for (const auto& m : v) {
+                    running = brd_callback(apply<side_i>(board.state, m), depth + 1);
+                    if (!running) {
+                        break;
+                    }
                 }
-            } else {
-                // Iterate all branches in normal order
+            }
+        }
+
+        if (v.size() == 0) {
+            print_win_line(depth);
+            return;
+        }
 
-                size_t branch = 0;
-                for (const auto& next_brd : v) {
-                    _handle_brd(sp, next_brd, depth, branch++);
+        for_each_branch(v.size(), [&] (size_t i) {
+            const move_t& m = v[i];
+            undo_t u = enable_cache ? make_move<side_i>(board, m) : make_move<side_i>(board.state, m);
+            if constexpr (single_thread) {
+                if (print_win_path) {
+                    line.push_back(m);
                 }
             }
-        } else {
-            if (randomize) {
-                // Iterate limited number or branches in random order
-
-                size_t len = std::min(max_width, v.size());
-                const auto& indexes = random_indexes[v.size()];
-                for (size_t i = 0; i < len; i++) {
-                    size_t index = indexes[i];
-                    _handle_brd(sp, v[index], depth, index);
+
+            _handle_in_place<1 - side_i>(sp + 1, depth + 1, i);
+
+            if constexpr (single_thread) {
+                if (print_win_path) {
+                    line.pop_back();
                 }
-            } else {
-                // Iterate limited number of branches - 1, 2 or 3
+            }
+            unmake_move<side_i>(board, m, u);
+        });
+    }
+
+    // Iterative search: frames[0, levels) are boards on the path from root board,
+    // moves of every board are in generator of the same stack level.
+    // The whole state of search is in frames, so it can be stopped and continued.
+    // Boards are visited in the same order and with the same stats as in _search_r().
+    void start_iterative(const board_state_t& brd)
+    {
+        levels = 0;
+        frames[0].brd = keyed_board_t(brd);
+        pending = true;
+    }
+
+    // search of boards one by one, until all are completed or search is stopped
+    void search_roots()
+    {
+        while (next_root < roots.size()) {
+            if (levels == 0 && !pending) {
+                start_iterative(roots[next_root]);
+            }
+
+            // root is done before checkpoint is written, even if search is stopped after its last board,
+            // otherwise it's searched again and counted twice
+            if (run_iterative()) {
+                next_root++;
+            }
+
+            if (checkpoint_due) {
+                checkpoint_due = false;
+                checkpoint();
+                next_checkpoint = Clock::now() + checkpoint_period;
+                continue;
+            }
+            if (!running) {
+                return;
+            }
+        }
+    }
+
+    // until search of current root is completed or stopped, true if completed
+    bool run_iterative()
+    {
+        if (pending) {
+            // board was visited before search stopped, but not expanded
+            pending = false;
+            handle_status();
+            if (!running) {
+                pending = true;
+                return false;
+            }
+            if (enter_frame(levels)) {
+                levels++;
+            }
+        }
+
+        while (levels > 0) {
+            frame_t& f = frames[levels - 1];
+            if (f.next == f.count) {
+                // all branches are visited, go up
+                levels--;
+                if constexpr (single_thread) {
+                    if (print_win_path) {
+                        path.pop_back();
+                    }
+                }
+                continue;
+            }
 
-                _handle_brd(sp, v.front(), depth, 0);
-                if (max_width == 3 && v.size() >= 3) {
-                    size_t i = v.size() / 2;
-                    _handle_brd(sp, v[i], depth, i);
+            size_t depth = root_depth + levels - 1;
+            bool deeper = depth % 2 == 0 ? next_frame<0>(f, levels, depth)
+                                         : next_frame<1>(f, levels, depth);
+            if (deeper) {
+                levels++;
+            } else if (!running || checkpoint_due) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool enter_frame(size_t level)
+    {
+        size_t depth = root_depth + level;
+        if (depth % 2 == 0) {
+            return _enter_frame<0>(frames[level], stack[level], depth);
+        } else {
+            return _enter_frame<1>(frames[level], stack[level], depth);
+        }
+    }
+
+    // board of frame is expanded, false if there are no branches to go deeper
+    template<size_t side_i>
+    bool _enter_frame(frame_t& f, moves_generator& g, size_t depth)
+    {
+        if (bulk_count_leaves && depth + 1 == max_depth) {
+            size_t n = g.template count_next_moves<side_i>(f.brd.state);
+            sts.consume_level_width(n, depth);
+            sts.depth_limit(n);
+            return false;
+        }
+
+        const move_list_t& v = g.template gen_next_moves<side_i>(f.brd.state);
+        sts.consume_level_width(v.size(), depth);
+
+        if constexpr (single_thread) {
+            if (brd_callback && v.size() > 0) {
+                for (const auto& m : v) {
+                    running = brd_callback(apply<side_i>(f.brd.state, m), depth + 1);
+                    if (!running) {
+                        break;
+                    }
                 }
-                if (max_width >= 2 && v.size() >= 2) {
-                    _handle_brd(sp, v.back(), depth, v.size() - 1);
+            }
+        }
+
+        if (v.size() == 0) {
+            print_win(f.brd.state, depth);
+            return false;
+        }
+
+        if constexpr (single_thread) {
+            if (print_win_path) {
+                path.push_back(f.brd.state);
+            }
+        }
+
+        f.moves = &v;
+        f.count = branches_count(v.size());
+        f.next = 0;
+        return true;
+    }
+
+    // Visit next branch of frame 'f' of side_i move, true if frame of child board on 'level' is entered.
+    template<size_t side_i>
+    bool next_frame(frame_t& f, size_t level, size_t depth)
+    {
+        frame_t& child = frames[level];
+        size_t i = branch(f.next++, f.moves->size());
+        child.brd = next_board<side_i>(f.brd, (*f.moves)[i]);
+        depth++;
+
+        if constexpr (single_thread) {
+            if (verbose) {
+                print_board(child.brd.state, depth, i);
+            }
+        }
+
+        if (enable_cache && cached<1 - side_i>(child.brd, depth)) {
+            return false;
+        }
+
+        if (depth == max_depth) {
+            sts.depth_limit();
+            return false;
+        }
+
+        handle_status();
+        if (!running || checkpoint_due) {
+            pending = true;
+            return false;
+        }
+
+        return _enter_frame<1 - side_i>(child, stack[level], depth);
+    }
+
+    // Successors are generated one at a time, right before visiting,
+    // only max_width of them in normal order are generated (all if 0), randomize is not applicable.
+    // Level width is the number of generated successors.
+    template<size_t side_i>
+    void _search_lazy(moves_generator* sp, const keyed_board_t& brd, size_t depth)
+    {
+        // capture sequences are kept in buffer of current stack level
+        lazy_moves_t<side_i> moves(*sp, brd.state);
+
+        if constexpr (single_thread) {
+            if (print_win_path) {
+                path.push_back(brd.state);
+            }
+        }
+
+        size_t branch = 0;
+        for (const move_t& m : moves) {
+            keyed_board_t next = next_board<side_i>(brd, m);
+
+            if constexpr (single_thread) {
+                if (brd_callback) {
+                    running = brd_callback(next.state, depth + 1);
                 }
             }
+
+            if (running) {
+                _handle_brd<1 - side_i>(sp + 1, next, depth + 1, branch);
+            }
+
+            branch++;
+            if (!running || branch == max_width) {
+                break;
+            }
         }
 
         if constexpr (single_thread) {
@@ -423,23 +1181,58 @@ private:
                 path.pop_back();
             }
         }
+
+        sts.consume_level_width(branch, depth);
+        if (branch == 0) {
+            print_win(brd.state, depth);
+        }
     }
 
     const size_t max_depth;
     const bool randomize;
+    const bool lazy;
+    const bool enable_chain_cache;
+    const bool in_place;
+    const bool iterative;
     const size_t max_width;
     const bool verbose;
     const Clock::time_point run_until;
     
-    std::vector<board_states_generator> stack;
+    std::vector<moves_generator> stack;
+    // capture sequences of pieces, shared by all depths
+    chain_cache_t chain_cache;
 
     const bool enable_cache;
+    const bool checkpoint_cache;
     Cache boards_cache;
 
     const bool print_win_path;
+    bool bulk_count_leaves;
     const bool print_cache_hit_board;
     std::vector<board_state_t> path;
 
+    // in-place search: current board, moves from root board
+    keyed_board_t board;
+    std::vector<move_t> line;
+    board_state_t root;
+    size_t root_depth;
+
+    // iterative search
+    std::vector<frame_t> frames;
+    size_t levels = 0;
+    // board of frames[levels] is not expanded yet
+    bool pending = false;
+    // boards of iterative search, the same depth
+    std::vector<board_state_t> roots;
+    size_t next_root = 0;
+
+    std::function<void()> checkpoint;
+    Clock::duration checkpoint_period{0};
+    Clock::time_point next_checkpoint;
+    bool checkpoint_due = false;
+    Clock::duration elapsed_before{0};
+    uint32_t seed;
+
     Clock::time_point started;
     Clock::time_point next_status_print;
     size_t next_total_boards;
@@ -454,3 +1247,5 @@ private:
 
     brd_callback_t brd_callback;
 };
+
+ENGINE_NAMESPACE_END
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <cassert>
 #include <cstdio>
 #include <array>
+#include <limits>
 #include <utility>
 #include <vector>
 #include <algorithm>
@@ -11,6 +13,8 @@
 
 using namespace std::string_literals;
 
+ENGINE_NAMESPACE_BEGIN
+
 
 struct board_side_t
 {
@@ -76,7 +80,7 @@ struct board_state_t
 
 inline const board_state_t initial_board = {board_side_t{0, 0x0FFF}, board_side_t{0, 0xFFF00000}};
 
-inline const brd_index_t format_table[8][8] = {
+inline constexpr brd_index_t format_table[8][8] = {
     {{}, 28, {}, 29, {}, 30, {}, 31},
     {24, {}, 25, {}, 26, {}, 27, {}},
     {{}, 20, {}, 21, {}, 22, {}, 23},
@@ -150,44 +154,577 @@ board_state_t rotate(const board_state_t& s)
 {
     return {reverse(s.sides[1]), reverse(s.sides[0])};
 }
-//TODO: benchmark rotation
 
+static_assert(sizeof(board_state_t) == 16);
+
+
+// Boards are kept in absolute orientation, moving side is a compile-time parameter:
+// side 0 (white) moves up and becomes king on the top row,
+// side 1 (black) moves down and becomes king on the bottom row.
+
+template<size_t side_i>
+inline constexpr brd_map_t king_row = side_i == 0 ? 0xF0000000u : 0x0000000Fu;
+
+// simple items of the side move only in forward directions
+template<size_t side_i, size_t dir_i>
+constexpr bool is_forward()
+{
+    return ray_goes_up<dir_i>() == (side_i == 0);
+}
 
+template<size_t side_i>
+inline constexpr std::array<size_t, 2> forward_directions = side_i == 0 ? std::array<size_t, 2>{0, 1} : std::array<size_t, 2>{2, 3};
+
+template<size_t side_i = 0>
 board_state_t do_move(board_state_t state, brd_item_t src, brd_item_t dst)
 {
-    state.sides[0].items -= src;
-    state.sides[0].items += dst;
+    board_side_t& player = state.sides[side_i];
+
+    player.items -= src;
+    player.items += dst;
 
-    if (state.sides[0].kings.exist(src)) {
-        state.sides[0].kings -= src;
-        state.sides[0].kings += dst;
+    if (player.kings.exist(src)) {
+        player.kings -= src;
+        player.kings += dst;
     }
 
     // become new king
-    if (dst.is_on_king_row()) {
-        state.sides[0].kings += dst;
+    if (king_row<side_i>.exist(dst)) {
+        player.kings += dst;
     }
 
     return state;
 }
 
+template<size_t side_i = 0>
 board_state_t do_capture(board_state_t state, brd_map_t capture)
 {
-    state.sides[1].items -= capture;
-    if (state.sides[1].kings.exist_any(capture)) {
-        state.sides[1].kings -= capture;
+    board_side_t& enemy = state.sides[1 - side_i];
+
+    enemy.items -= capture;
+    if (enemy.kings.exist_any(capture)) {
+        enemy.kings -= capture;
     }
     return state;
 }
 
 
+// Compact record of move or whole capture sequence of moving side piece,
+// half the size of board_state_t, board is materialized with apply() only when needed.
+struct move_t
+{
+    uint8_t src;
+    uint8_t dst;
+    // simple item became king during move or capture sequence
+    bool promotion;
+    brd_map_t captured;
+};
+
+static_assert(sizeof(move_t) == 8);
+
+template<size_t side_i = 0>
+board_state_t apply(board_state_t state, const move_t& m)
+{
+    auto src = brd_item_t(brd_index_t(m.src));
+    auto dst = brd_item_t(brd_index_t(m.dst));
+    board_side_t& player = state.sides[side_i];
+
+    bool king = m.promotion || player.kings.exist(src);
+
+    // src and dst are the same square if capture sequence returned piece back
+    player.items -= src;
+    player.kings -= src;
+    player.items += dst;
+    if (king) {
+        player.kings += dst;
+    }
+
+    return do_capture<side_i>(state, m.captured);
+}
+
+
+// Zobrist keys: board key is XOR of random keys of its pieces,
+// so it's updated incrementally by moves and captures instead of hashing whole board.
+// King is also in items mask, so key of king is items key XOR kings key of the square.
+// Black keys are keys of white mirrored squares with halves swapped,
+// so key of rotate(board) is key of board with halves swapped - see rotate_key().
+struct zobrist_table_t
+{
+    uint64_t items[2][32];
+    uint64_t kings[2][32];
+};
+
+constexpr uint64_t rotate_key(uint64_t key)
+{
+    return (key << 32) | (key >> 32);
+}
+
+constexpr zobrist_table_t gen_zobrist_table()
+{
+    zobrist_table_t t{};
+    // splitmix64, fixed seed - keys are the same in every build
+    uint64_t x = 0x5EED5EED5EED5EEDull;
+    auto next = [&x] () {
+        uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    };
+    for (size_t i = 0; i < 32; i++) {
+        t.items[0][i] = next();
+        t.kings[0][i] = next();
+    }
+    for (size_t i = 0; i < 32; i++) {
+        t.items[1][i] = rotate_key(t.items[0][31 - i]);
+        t.kings[1][i] = rotate_key(t.kings[0][31 - i]);
+    }
+    return t;
+}
+
+inline constexpr zobrist_table_t zobrist = gen_zobrist_table();
+
+// key of pieces of 'side' on squares 'm'
+inline uint64_t pieces_key(const board_side_t& side, size_t side_i, brd_map_t m)
+{
+    uint64_t key = 0;
+    for (brd_index_t i : m) {
+        key ^= zobrist.items[side_i][i.index];
+    }
+    for (brd_index_t i : m.select(side.kings)) {
+        key ^= zobrist.kings[side_i][i.index];
+    }
+    return key;
+}
+
+inline uint64_t zobrist_key(const board_state_t& s)
+{
+    return pieces_key(s.sides[0], 0, s.sides[0].items) ^ pieces_key(s.sides[1], 1, s.sides[1].items);
+}
+
+// XOR of keys of board before and after apply() of move
+template<size_t side_i = 0>
+uint64_t move_key(const board_state_t& state, const move_t& m)
+{
+    constexpr size_t enemy_i = 1 - side_i;
+    bool king = state.sides[side_i].kings.exist(brd_item_t(brd_index_t(m.src)));
+
+    uint64_t key = zobrist.items[side_i][m.src] ^ zobrist.items[side_i][m.dst];
+    if (king) {
+        key ^= zobrist.kings[side_i][m.src] ^ zobrist.kings[side_i][m.dst];
+    } else if (m.promotion) {
+        key ^= zobrist.kings[side_i][m.dst];
+    }
+
+    if (m.captured) {
+        key ^= pieces_key(state.sides[enemy_i], enemy_i, m.captured);
+    }
+    return key;
+}
+
+// Board with its Zobrist key, kept up to date by do_move(), do_capture() and apply().
+struct keyed_board_t
+{
+    keyed_board_t() = default;
+    keyed_board_t(const board_state_t& state, uint64_t key) : state(state), key(key) {}
+    explicit keyed_board_t(const board_state_t& state) : state(state), key(zobrist_key(state)) {}
+
+    board_state_t state;
+    uint64_t key = 0;
+};
+
+template<size_t side_i = 0>
+keyed_board_t do_move(const keyed_board_t& b, brd_item_t src, brd_item_t dst)
+{
+    size_t src_i = brd_map_t(src).lowest_index().index;
+    size_t dst_i = brd_map_t(dst).lowest_index().index;
+
+    uint64_t key = b.key ^ zobrist.items[side_i][src_i] ^ zobrist.items[side_i][dst_i];
+    if (b.state.sides[side_i].kings.exist(src)) {
+        key ^= zobrist.kings[side_i][src_i] ^ zobrist.kings[side_i][dst_i];
+    } else if (king_row<side_i>.exist(dst)) {
+        key ^= zobrist.kings[side_i][dst_i];
+    }
+
+    return {do_move<side_i>(b.state, src, dst), key};
+}
+
+template<size_t side_i = 0>
+keyed_board_t do_capture(const keyed_board_t& b, brd_map_t capture)
+{
+    constexpr size_t enemy_i = 1 - side_i;
+    uint64_t key = b.key ^ pieces_key(b.state.sides[enemy_i], enemy_i, capture);
+    return {do_capture<side_i>(b.state, capture), key};
+}
+
+template<size_t side_i = 0>
+keyed_board_t apply(const keyed_board_t& b, const move_t& m)
+{
+    return {apply<side_i>(b.state, m), b.key ^ move_key<side_i>(b.state, m)};
+}
+
+keyed_board_t rotate(const keyed_board_t& b)
+{
+    return {rotate(b.state), rotate_key(b.key)};
+}
+
+
+// Moves on single mutable board: make_move() changes board in place
+// and returns what apply() loses, unmake_move() with the same move restores the board.
+struct undo_t
+{
+    // kings among captured enemies
+    brd_map_t captured_kings;
+    // XOR of keys before and after move, keyed board only
+    uint64_t key = 0;
+};
+
+template<size_t side_i = 0>
+undo_t make_move(board_state_t& state, const move_t& m)
+{
+    undo_t u{state.sides[1 - side_i].kings.select(m.captured)};
+    state = apply<side_i>(state, m);
+    return u;
+}
+
+template<size_t side_i = 0>
+void unmake_move(board_state_t& state, const move_t& m, const undo_t& u)
+{
+    auto src = brd_item_t(brd_index_t(m.src));
+    auto dst = brd_item_t(brd_index_t(m.dst));
+    board_side_t& player = state.sides[side_i];
+    board_side_t& enemy = state.sides[1 - side_i];
+
+    bool king = !m.promotion && player.kings.exist(dst);
+
+    player.items -= dst;
+    player.kings -= dst;
+    player.items += src;
+    if (king) {
+        player.kings += src;
+    }
+
+    enemy.items += m.captured;
+    enemy.kings += u.captured_kings;
+}
+
+template<size_t side_i = 0>
+undo_t make_move(keyed_board_t& b, const move_t& m)
+{
+    uint64_t key = move_key<side_i>(b.state, m);
+    undo_t u = make_move<side_i>(b.state, m);
+    u.key = key;
+    b.key ^= key;
+    return u;
+}
+
+template<size_t side_i = 0>
+void unmake_move(keyed_board_t& b, const move_t& m, const undo_t& u)
+{
+    unmake_move<side_i>(b.state, m, u);
+    b.key ^= u.key;
+}
+
+// More than twice of max number of moves ever seen in random positions (58).
+#define MAX_MOVES 128
+
+// Bound of moves without capture: every one ends on empty square, and an empty square is reached
+// only by the first own piece on each of its 4 diagonals, so n pieces make at most min(13 * n, 4 * (32 - n))
+// moves (king in the center reaches 13 squares).
+// Captures keep only distinct final boards and have no such simple bound, push_back() asserts the limit.
+constexpr size_t max_quiet_moves()
+{
+    size_t r = 0;
+    for (size_t n = 1; n <= 12; n++) {
+        r = std::max(r, std::min(13 * n, 4 * (32 - n)));
+    }
+    return r;
+}
+static_assert(max_quiet_moves() <= MAX_MOVES);
+
+// Fixed buffer of moves, no allocations in generator.
+struct move_list_t
+{
+    void clear()
+    {
+        count = 0;
+    }
+
+    void push_back(const move_t& m)
+    {
+        assert(count < MAX_MOVES);
+        moves[count++] = m;
+    }
+
+    size_t size() const
+    {
+        return count;
+    }
 
+    const move_t& operator[](size_t i) const
+    {
+        return moves[i];
+    }
 
+    const move_t& front() const
+    {
+        return moves[0];
+    }
+
+    const move_t& back() const
+    {
+        return moves[count - 1];
+    }
 
+    const move_t* begin() const
+    {
+        return moves.data();
+    }
+
+    const move_t* end() const
+    {
+        return moves.data() + count;
+    }
+
+private:
+    std::array<move_t, MAX_MOVES> moves;
+    size_t count = 0;
+};
+
+
+// Cheap side-wide check if moving side has any capture available,
+// without following capture sequences.
+// - simple item: enemy item on adjacent diagonal square and empty square behind it;
+// - king: first non-empty square on diagonal ray is an enemy item and empty square behind it.
+template<size_t side_i = 0>
+bool can_capture(const board_state_t& state)
+{
+    const board_side_t& player = state.sides[side_i];
+    brd_map_t enemies = state.sides[1 - side_i].items;
+    brd_map_t empty = ~state.occupied().mask;
+
+    // kings are also able to capture as simple items
+    brd_map_t items = player.items;
+    brd_map_t kings = player.kings;
+
+    brd_map_t dst = jump<0>(items, enemies, empty) + jump<1>(items, enemies, empty)
+                  + jump<2>(items, enemies, empty) + jump<3>(items, enemies, empty);
+    if (dst || !kings) {
+        return bool(dst);
+    }
+
+    dst = jump<0>(slide<0>(kings, empty), enemies, empty) + jump<1>(slide<1>(kings, empty), enemies, empty)
+        + jump<2>(slide<2>(kings, empty), enemies, empty) + jump<3>(slide<3>(kings, empty), enemies, empty);
+
+    return bool(dst);
+}
+
+// Side has any legal move, terminal position otherwise (side lost).
+// Answered from side-wide masks without enumeration of moves:
+// simple item can step forward or king can step in any direction to adjacent empty square,
+// otherwise the only chance is capture - every capture jumps over adjacent or distant enemy.
+template<size_t side_i = 0>
+bool has_any_legal_move(const board_state_t& state)
+{
+    const board_side_t& player = state.sides[side_i];
+    brd_map_t items = player.items - player.kings;
+    brd_map_t kings = player.kings;
+    brd_map_t empty = ~state.occupied().mask;
+
+    constexpr size_t fwd_i = forward_directions<side_i>[0];
+    constexpr size_t fwd_j = forward_directions<side_i>[1];
+    brd_map_t steps = step<fwd_i>(items) + step<fwd_j>(items)
+                    + step<0>(kings) + step<1>(kings) + step<2>(kings) + step<3>(kings);
+
+    return steps.exist_any(empty) || can_capture<side_i>(state);
+}
+
+
+// Side-wide masks of single board, computed by batch kernels for many boards at once.
+struct board_masks_t
+{
+    bool can_capture;
+    // destinations of simple items moves in forward_directions, if there is no capture
+    std::array<brd_map_t, 2> items_moves;
+};
+
+
+// Pieces movement policies of generator.
+// Policy describes moves and jumps of a single piece in given direction,
+// all policy decisions are resolved at compile time.
+
+struct jump_t
+{
+    brd_map_t capture;
+    brd_map_t dst;
+};
+
+// Simple item moves forward to adjacent square,
+// captures adjacent enemy in any direction and jumps to the square right behind it.
+struct item_policy
+{
+    // jump destination is known at compile time
+    static constexpr bool fixed_dst = true;
+
+    template<int index, size_t dir_i>
+    static constexpr brd_map_t capture_square = step<dir_i>(brd_map_t(1u << index));
+
+    template<int index, size_t dir_i>
+    static constexpr brd_map_t jump_square = step<dir_i>(capture_square<index, dir_i>);
+
+    template<int index, size_t dir_i>
+    static jump_t jump(brd_map_t occupied, brd_map_t may_be_captured)
+    {
+        constexpr brd_map_t capture = capture_square<index, dir_i>;
+        constexpr brd_map_t dst = jump_square<index, dir_i>;
+
+        if (!dst || !may_be_captured.exist_any(capture) || occupied.exist_any(dst)) {
+            return {};
+        }
+        return {capture, dst};
+    }
+
+    template<size_t side_i, size_t dir_i>
+    static brd_map_t move_dst(brd_index_t item_pos, brd_map_t occupied)
+    {
+        // items move only forward
+        if constexpr (is_forward<side_i, dir_i>()) {
+            return step<dir_i>(brd_map_t(brd_item_t(item_pos))) - occupied;
+        } else {
+            return {};
+        }
+    }
+
+    using continuation = item_policy;
+};
+
+// King moves along diagonal ray up to the first occupied square.
+// To capture, first occupied square on the ray must be an enemy,
+// and jump destinations are all empty squares behind it up to the next occupied square.
+struct king_policy
+{
+    static constexpr bool fixed_dst = false;
+
+    template<int index, size_t dir_i>
+    static jump_t jump(brd_map_t occupied, brd_map_t may_be_captured)
+    {
+        constexpr uint32_t ray = tables.king_rays[index][dir_i].mask;
+        brd_map_t capture = first_blocker<dir_i>(ray, occupied);
+
+        // cant't jump over allies or already captured enemies
+        if (!may_be_captured.exist_any(capture)) {
+            return {};
+        }
+
+        // cant't jump over multiple enemy items
+        brd_map_t behind = ray_beyond<dir_i>(ray, capture);
+        return {capture, ray_before<dir_i>(behind, first_blocker<dir_i>(behind, occupied))};
+    }
+
+    template<size_t side_i, size_t dir_i>
+    static brd_map_t move_dst(brd_index_t item_pos, brd_map_t occupied)
+    {
+        // can't jump while move without capture
+        brd_map_t ray = tables.king_rays[item_pos.index][dir_i];
+        return ray_before<dir_i>(ray, first_blocker<dir_i>(ray, occupied));
+    }
+
+    // after the first jump capture sequence continues with simple item jumps
+    using continuation = item_policy;
+};
+
+// destinations of moves without capture of piece on 'item_pos' in all directions
+template<class Policy, size_t side_i>
+brd_map_t moves_dst(brd_index_t item_pos, brd_map_t occupied)
+{
+    return Policy::template move_dst<side_i, 0>(item_pos, occupied)
+         + Policy::template move_dst<side_i, 1>(item_pos, occupied)
+         + Policy::template move_dst<side_i, 2>(item_pos, occupied)
+         + Policy::template move_dst<side_i, 3>(item_pos, occupied);
+}
+
+
+// Cache of capture sequences results of single piece.
+// Sequences of simple item depend only on part of the board: item jumps to squares
+// of the same row and column parity as its own square (landing squares) over squares of the other parity,
+// so key is occupancy of landing squares and enemies on the other ones.
+// King jumps along rays first, so its key is occupancy and enemies of whole board.
+// Simple items are cached per direction of the first jump, so results are replayed in the same order
+// as generated without cache.
+
+// compile-time landing squares of simple item jumps for every square
+constexpr std::array<brd_map_t, 32> gen_landing_squares()
+{
+    std::array<brd_map_t, 32> r{};
+    for (size_t i = 0; i < 32; i++) {
+        for (size_t j = 0; j < 32; j++) {
+            if (brd_1d_to_2d_table[i].x % 2 == brd_1d_to_2d_table[j].x % 2) {
+                r[i].mask |= 1u << j;
+            }
+        }
+    }
+    return r;
+}
+
+inline constexpr std::array<brd_map_t, 32> landing_squares = gen_landing_squares();
+
+// result of capture sequence, piece started on the square of cache entry
+struct chain_outcome_t
+{
+    uint8_t dst;
+    bool promotion;
+    brd_map_t captured;
+};
+
+// Pieces with more results are not cached, entry is single cache line.
+#define CHAIN_CACHE_OUTCOMES 6
+
+struct chain_cache_entry_t
+{
+    // occupancy << 32 | enemies, masked as described above
+    uint64_t masks;
+    // 1 + square | kind << 5 | side << 8, 0 - empty entry, see piece_chains()
+    uint16_t piece = 0;
+    uint8_t size;
+    std::array<chain_outcome_t, CHAIN_CACHE_OUTCOMES> outcomes;
+};
+
+static_assert(sizeof(chain_cache_entry_t) == 64);
+
+// Direct-mapped, entry is overwritten by any other piece with the same slot.
+// One cache per thread, shared by generators of all depths.
+struct chain_cache_t
+{
+    static constexpr size_t bits = 12;
+
+    chain_cache_t() :
+        entries(size_t(1) << bits)
+    {}
+
+    chain_cache_entry_t& slot(uint16_t piece, uint64_t masks)
+    {
+        uint64_t h = (masks ^ (uint64_t(piece) << 48)) * 0x9E3779B97F4A7C15ull;
+        return entries[h >> (64 - bits)];
+    }
+
+    std::vector<chain_cache_entry_t> entries;
+    size_t lookups = 0;
+    size_t hits = 0;
+};
+
+
+// Generator of next states for moving side 'side_i', see do_move().
+template<size_t side_i = 0>
 struct _board_states_generator
 {
+    static constexpr size_t enemy_i = 1 - side_i;
+
     _board_states_generator(std::vector<board_state_t>& buffer) :
-        _states(buffer)
+        _states(&buffer)
+    {}
+
+    // compact moves mode: boards are not materialized
+    _board_states_generator(move_list_t& buffer) :
+        _moves(&buffer)
     {}
 
     _board_states_generator(const _board_states_generator&) = delete;
@@ -197,22 +734,67 @@ struct _board_states_generator
 
     size_t gen_item_captures(brd_index_t item_pos)
     {
-        const board_side_t& player = cur_state.sides[0];
+        const board_side_t& player = cur_state.sides[side_i];
         auto item = brd_item_t(item_pos);
 
         if (player.kings.exist(item)) {
-            next_king_captures(cur_state, item_pos, {});
+            chain_src = item_pos;
+            piece_chains(item_pos, king_chains, [&] {
+                next_captures<king_policy>(cur_state, item_pos, {});
+            });
         } else if (player.items.exist(item)) {
-            next_item_captures(cur_state, item_pos, {});
+            // the same directions order as item_policy kernels
+            brd_map_t enemies = cur_state.sides[enemy_i].items;
+            brd_map_t empty = ~occupied.mask;
+            gen_items_jumps<0>(brd_map_t(item), enemies, empty);
+            gen_items_jumps<1>(brd_map_t(item), enemies, empty);
+            gen_items_jumps<2>(brd_map_t(item), enemies, empty);
+            gen_items_jumps<3>(brd_map_t(item), enemies, empty);
         }
 
         return generated;
     }
 
+    // first jump of every simple item in given direction, computed for whole side at once,
+    // only items with available jump go into recursion to follow capture sequence
+    template<size_t dir_i>
+    void gen_items_jumps(brd_map_t items, brd_map_t enemies, brd_map_t empty)
+    {
+        constexpr size_t back_i = opposite_direction(dir_i);
+
+        for (brd_index_t dst_index : jump<dir_i>(items, enemies, empty)) {
+            auto dst = brd_item_t(dst_index);
+            brd_map_t capture = step<back_i>(brd_map_t(dst));
+            brd_map_t src = step<back_i>(capture);
+            chain_src = src.lowest_index();
+
+            piece_chains(chain_src, dir_i, [&] {
+                // do move
+                board_state_t next_state = do_move<side_i>(cur_state, brd_item_t(chain_src), dst);
+
+                // try continue capturing
+                next_captures<item_policy>(next_state, dst_index, capture);
+            });
+        }
+    }
+
     size_t gen_captures()
     {
-        for (brd_index_t pos = 0; pos; ++pos) {
-            gen_item_captures(pos);
+        const board_side_t& player = cur_state.sides[side_i];
+        brd_map_t items = player.items - player.kings;
+        brd_map_t enemies = cur_state.sides[enemy_i].items;
+        brd_map_t empty = ~occupied.mask;
+
+        gen_items_jumps<0>(items, enemies, empty);
+        gen_items_jumps<1>(items, enemies, empty);
+        gen_items_jumps<2>(items, enemies, empty);
+        gen_items_jumps<3>(items, enemies, empty);
+
+        for (brd_index_t pos : player.kings) {
+            chain_src = pos;
+            piece_chains(pos, king_chains, [&] {
+                next_captures<king_policy>(cur_state, pos, {});
+            });
         }
 
         return generated;
@@ -222,20 +804,94 @@ struct _board_states_generator
     {
         auto item = brd_item_t(item_pos);
 
-        const board_side_t& player = cur_state.sides[0];
+        const board_side_t& player = cur_state.sides[side_i];
         if (player.kings.exist(item)) {
-            next_king_moves(item_pos);
+            next_moves<king_policy>(item_pos);
         } else if (player.items.exist(item)) {
-            next_item_moves(item_pos);
+            next_moves<item_policy>(item_pos);
         }
 
         return generated;
     }
 
+    // forward moves of all simple items in given direction, destinations computed for whole side at once
+    template<size_t dir_i>
+    void gen_items_moves(brd_map_t dst)
+    {
+        constexpr size_t back_i = opposite_direction(dir_i);
+
+        for (brd_index_t dst_index : dst) {
+            brd_map_t src = step<back_i>(brd_map_t(brd_item_t(dst_index)));
+            save_move(src.lowest_index(), dst_index);
+        }
+    }
+
     size_t gen_moves()
     {
-        for (brd_index_t item_pos = 0; item_pos; ++item_pos) {
-            gen_item_moves(item_pos);
+        const board_side_t& player = cur_state.sides[side_i];
+        brd_map_t items = player.items - player.kings;
+        brd_map_t empty = ~occupied.mask;
+
+        // items move only forward
+        constexpr size_t fwd_i = forward_directions<side_i>[0];
+        constexpr size_t fwd_j = forward_directions<side_i>[1];
+        gen_items_moves<fwd_i>(step<fwd_i>(items).select(empty));
+        gen_items_moves<fwd_j>(step<fwd_j>(items).select(empty));
+
+        for (brd_index_t item_pos : player.kings) {
+            next_moves<king_policy>(item_pos);
+        }
+
+        return generated;
+    }
+
+    // number of moves without captures, nothing is saved
+    size_t count_moves() const
+    {
+        const board_side_t& player = cur_state.sides[side_i];
+        brd_map_t items = player.items - player.kings;
+        brd_map_t empty = ~occupied.mask;
+
+        constexpr size_t fwd_i = forward_directions<side_i>[0];
+        constexpr size_t fwd_j = forward_directions<side_i>[1];
+        size_t n = step<fwd_i>(items).select(empty).count() + step<fwd_j>(items).select(empty).count();
+
+        for (brd_index_t item_pos : player.kings) {
+            n += moves_dst<king_policy, side_i>(item_pos, occupied).count();
+        }
+
+        return n;
+    }
+
+    // Number of next states for bulk counting of leaves.
+    // Moves are counted with popcounts of destination masks,
+    // capture sequences are still enumerated and saved, because equal results must be deduplicated.
+    size_t count_next_states(const board_state_t& brd)
+    {
+        prepare(brd);
+
+        if (can_capture<side_i>(cur_state)) {
+            return gen_captures();
+        }
+
+        return count_moves();
+    }
+
+    // Same as gen_next_states(), with side-wide masks precomputed for batch of boards (see draughts_batch.h),
+    // only enumeration of moves and capture sequences is left.
+    size_t gen_next_states(const board_state_t& brd, const board_masks_t& masks)
+    {
+        prepare(brd);
+
+        if (masks.can_capture) {
+            return gen_captures();
+        }
+
+        gen_items_moves<forward_directions<side_i>[0]>(masks.items_moves[0]);
+        gen_items_moves<forward_directions<side_i>[1]>(masks.items_moves[1]);
+
+        for (brd_index_t item_pos : cur_state.sides[side_i].kings) {
+            next_moves<king_policy>(item_pos);
         }
 
         return generated;
@@ -245,7 +901,8 @@ struct _board_states_generator
     {
         cur_state = brd;
         occupied = cur_state.occupied();
-        bit_filter = board_state_t{board_side_t{0, 0}, board_side_t{0, 0}};
+        out_base = _moves ? _moves->size() : _states->size();
+        dedup_clean = false;
         generated = 0;
     }
 
@@ -256,214 +913,249 @@ struct _board_states_generator
         prepare(brd);
 
         // As capture is mandatory and can't be skipped
-        // So first - try capture, and if no available captures - then try move
-        if (gen_captures()) {
-            return generated;
+        // So first - check if any capture is available, and if no available captures - then try move
+        if (can_capture<side_i>(cur_state)) {
+            return gen_captures();
         }
 
         return gen_moves();
     }
 
 
-    // move active item between recursive calls (change state) and collect captured enemies
-    // when capture sequence completed - remove captured enemies before state saved
-    size_t next_item_captures(const board_state_t& state, brd_index_t item_pos, brd_map_t captured)
+    // move without capture - save new state or move record
+    void save_move(brd_index_t src, brd_index_t dst)
     {
-        // Rules:
-        // - enemy items have to be removed after capture chain finished completely
-        // - every enemy item can't be captured twice
-        brd_map_t available_dst = tables.capture_move_masks[item_pos.index] - state.occupied();
-        brd_map_t may_be_captured = state.sides[1].items.select(tables.capture_masks[item_pos.index]);
-
-        // not allow capture same items multiple times
-        may_be_captured -= captured;
-
-        size_t saved_states = 0;
-        if (may_be_captured && available_dst) {
-            for (auto [capture_item, dst_index] : tables.captures[item_pos.index]) {
-                auto dst = brd_item_t(dst_index);
-                if (!dst) {
-                    break;
-                }
-                // branching possible capture moves, follow moves
-                if (may_be_captured.exist(capture_item) && available_dst.exist(dst)) {
-                    // do move
-                    board_state_t next_state = do_move(state, brd_item_t(item_pos), dst);
+        if (_moves) {
+            bool promotion = king_row<side_i>.exist(brd_item_t(dst)) && !cur_state.sides[side_i].kings.exist(brd_item_t(src));
+            _moves->push_back({uint8_t(src.index), uint8_t(dst.index), promotion, {}});
+        } else {
+            _states->push_back(do_move<side_i>(cur_state, brd_item_t(src), brd_item_t(dst)));
+        }
+        generated++;
+    }
 
-                    // try continue capturing
-                    saved_states += next_item_captures(next_state, dst_index, captured + capture_item);
-                }
-            }
+    // i-th state saved since prepare()
+    board_state_t saved_state(size_t i) const
+    {
+        if (_moves) {
+            return apply<side_i>(cur_state, (*_moves)[out_base + i]);
+        } else {
+            return (*_states)[out_base + i];
         }
+    }
 
-        // nothing more can be captured
-        if (saved_states == 0) {
-            // capture sequence completed
-            if (captured) {
-                // do capture
-                board_state_t next_state = do_capture(state, captured);
-
-                bool duplicate = false;
-                if (bit_filter.contains(next_state)) {
-                    for (const auto& b : _states) {
-                        if (b == next_state) {
-                            duplicate = true;
-                            break;
-                        }
-                    }
-                }
+    // 'key' is Zobrist key of move, the same for equal final states of the same board
+    static size_t dedup_slot(uint64_t key)
+    {
+        // top 8 bits - one of 256 slots
+        return key >> 56;
+    }
 
-                if (!duplicate) {
-                    // save new state if it is final
-                    _states.push_back(next_state);
-                    bit_filter.bit_add(next_state);
-                    generated++;
-                }
-                return 1;
-            } else {
-                return 0;
+    // Different capture sequences may lead to the same final state,
+    // each final state is checked in open addressing set of states saved by current call.
+    bool is_duplicate(const board_state_t& next_state, uint64_t key)
+    {
+        // most of positions have no captures, so the set is cleared only when needed
+        if (!dedup_clean) {
+            dedup.fill(0);
+            dedup_clean = true;
+        }
+
+        // set holds at most MAX_MOVES states, less than number of slots,
+        // so probing always ends on empty slot
+        assert(generated < MAX_MOVES);
+
+        size_t slot = dedup_slot(key);
+        while (dedup[slot]) {
+            if (saved_state(dedup[slot] - 1) == next_state) {
+                return true;
             }
+            slot = (slot + 1) % dedup.size();
         }
 
-        return saved_states;
+        // state will be saved at index 'generated'
+        dedup[slot] = uint8_t(generated + 1);
+        return false;
     }
 
-    void next_item_moves(brd_index_t item_pos)
+    // kind of cached capture sequences: 0..3 - simple item with the first jump in this direction, or king
+    static constexpr size_t king_chains = 4;
+
+    // Capture sequences of piece on square 'pos' are followed by 'follow' or replayed from chain_cache.
+    template<class F>
+    void piece_chains(brd_index_t pos, size_t kind, F&& follow)
     {
-        brd_map_t available_dst = tables.fwd_dst_masks[item_pos.index] - occupied;
+        if (!chain_cache) {
+            follow();
+            return;
+        }
 
-        if (!available_dst) {
+        brd_map_t cur_occupied = occupied - brd_map_t(brd_item_t(pos));
+        brd_map_t enemies = cur_state.sides[enemy_i].items;
+        if (kind != king_chains) {
+            cur_occupied = cur_occupied.select(landing_squares[pos.index]);
+            enemies = enemies - landing_squares[pos.index];
+        }
+        uint64_t masks = uint64_t(cur_occupied.mask) << 32 | enemies.mask;
+        auto piece = uint16_t(1 + (pos.index | kind << 5 | side_i << 8));
+
+        chain_cache_entry_t& e = chain_cache->slot(piece, masks);
+        chain_cache->lookups++;
+
+        if (e.piece == piece && e.masks == masks) {
+            chain_cache->hits++;
+            for (size_t i = 0; i < e.size; i++) {
+                // piece moved to the end of sequence, captured enemies are still on board
+                const chain_outcome_t& o = e.outcomes[i];
+                save_captured(apply<side_i>(cur_state, {uint8_t(pos.index), o.dst, o.promotion, {}}), o.dst, o.captured);
+            }
             return;
         }
 
-        for (brd_item_t dst : tables.fwd_destinations[item_pos.index]) {
-            if (!dst) {
-                break;
+        // follow sequences and record results
+        recording = true;
+        recorded = 0;
+        follow();
+        recording = false;
+
+        if (recorded <= CHAIN_CACHE_OUTCOMES) {
+            e.piece = piece;
+            e.masks = masks;
+            e.size = uint8_t(recorded);
+            std::copy(recorded_outcomes.begin(), recorded_outcomes.begin() + recorded, e.outcomes.begin());
+        }
+    }
+
+    // capture sequence of piece moved from chain_src completed on square dst -
+    // remove captured enemies and save final state or move record
+    size_t save_captured(const board_state_t& state, brd_index_t dst, brd_map_t captured)
+    {
+        if (!captured) {
+            return 0;
+        }
+
+        // do capture
+        board_state_t next_state = do_capture<side_i>(state, captured);
+
+        bool promotion = !cur_state.sides[side_i].kings.exist(brd_item_t(chain_src))
+                      && state.sides[side_i].kings.exist(brd_item_t(dst));
+        move_t m{uint8_t(chain_src.index), uint8_t(dst.index), promotion, captured};
+
+        if (recording) {
+            if (recorded < CHAIN_CACHE_OUTCOMES) {
+                recorded_outcomes[recorded] = {m.dst, promotion, captured};
             }
-            if (available_dst.exist(dst)) {
-                // do move - get new board state
-                board_state_t next_state = do_move(cur_state, brd_item_t(item_pos), dst);
-                // save new state
-                _states.push_back(next_state);
-                generated++;
+            recorded++;
+        }
+
+        if (!is_duplicate(next_state, move_key<side_i>(cur_state, m))) {
+            // save new state if it is final
+            if (_moves) {
+                _moves->push_back(m);
+            } else {
+                _states->push_back(next_state);
             }
+            generated++;
         }
-    }
 
-    //TODO: Generalize items and kings tables and next_* functions, parametrize function template with const table
+        return 1;
+    }
 
-    size_t next_king_captures(const board_state_t& state, brd_index_t item_pos, brd_map_t captured)
+    // Capture kernel for piece on square 'index' jumping in direction 'dir_i'.
+    // For simple items capture and destination masks are compile-time constants,
+    // and continuation goes directly into kernels of destination square.
+    template<class Policy, int index, size_t dir_i>
+    size_t piece_jumps(const board_state_t& state, brd_map_t cur_occupied, brd_map_t may_be_captured, brd_map_t captured)
     {
-        brd_map_t cur_occupied = state.occupied();
-        brd_map_t available_dst = tables.king_capture_move_masks[item_pos.index] - cur_occupied;
-        brd_map_t may_be_captured = state.sides[1].items.select(tables.king_capture_masks[item_pos.index]);
-
-        // not allow capture same items multiple times
-        may_be_captured -= captured;
-
-        size_t saved_states = 0;
-        if (may_be_captured && available_dst) {
-            // iter directions
-            for (const auto& dir_captures : tables.king_captures[item_pos.index]) {
-                // iter captures in direction
-                for (const auto& dir_capture : dir_captures) {
-                    brd_item_t capture_item = dir_capture.first;
-
-                    if (!capture_item) {
-                        break;
-                    }
-                    // cant't jump over allies
-                    if (state.sides[0].items.exist(capture_item)) {
-                        break;
-                    }
-
-                    if (may_be_captured.exist(capture_item)) {
-                        // iter over possible jump destinations
-                        for (brd_index_t dst_index : dir_capture.second) {
-                            if (!dst_index) {
-                                break;
-                            }
-                            auto dst = brd_item_t(dst_index);
-
-                            // cant't jump over allies or capture/jump over multiple enemy items
-                            if (cur_occupied.exist(dst)) {
-                                break;
-                            }
-
-                            if (available_dst.exist(dst)) {
-                                // do move
-                                board_state_t next_state = do_move(state, brd_item_t(item_pos), dst);
-
-                                // try continue capturing
-                                saved_states += next_item_captures(next_state, dst_index, captured + capture_item);
-                            }
-                        }
-
-                        // cant't jump over enemies without capture
-                        break;
-                    }
+        using next_policy = typename Policy::continuation;
+
+        auto src = brd_item_t(brd_index_t(index));
+        jump_t j = Policy::template jump<index, dir_i>(cur_occupied, may_be_captured);
+
+        if constexpr (Policy::fixed_dst) {
+            constexpr brd_map_t dst = Policy::template jump_square<index, dir_i>;
+
+            if constexpr (!dst) {
+                // jump goes out of board
+                return 0;
+            } else {
+                constexpr int dst_index = __builtin_ctz(dst.mask);
+
+                if (!j.dst) {
+                    return 0;
                 }
+
+                // do move
+                board_state_t next_state = do_move<side_i>(state, src, brd_item_t(brd_index_t(dst_index)));
+
+                // try continue capturing
+                return piece_captures<next_policy, dst_index>(next_state, captured + j.capture);
             }
+        } else {
+            size_t saved_states = 0;
+            for (brd_index_t dst_index : j.dst) {
+                // do move
+                board_state_t next_state = do_move<side_i>(state, src, brd_item_t(dst_index));
+
+                // try continue capturing
+                saved_states += next_captures<next_policy>(next_state, dst_index, captured + j.capture);
+            }
+            return saved_states;
         }
+    }
 
-        // nothing more can be captured
-        if (saved_states == 0) {
-            // capture sequence completed
-            if (captured) {
-                // do capture
-                board_state_t next_state = do_capture(state, captured);
-
-                bool duplicate = false;
-                if (bit_filter.contains(next_state)) {
-                    for (const auto& b : _states) {
-                        if (b == next_state) {
-                            duplicate = true;
-                            break;
-                        }
-                    }
-                }
+    // move active piece between recursive calls (change state) and collect captured enemies
+    // when capture sequence completed - remove captured enemies before state saved
+    template<class Policy, int index>
+    size_t piece_captures(const board_state_t& state, brd_map_t captured)
+    {
+        // Rules:
+        // - enemy items have to be removed after capture chain finished completely
+        // - every enemy item can't be captured twice
+        brd_map_t cur_occupied = state.occupied();
+        brd_map_t may_be_captured = state.sides[enemy_i].items - captured;
 
-                if (!duplicate) {
-                    // save new state if it is final
-                    _states.push_back(next_state);
-                    bit_filter.bit_add(next_state);
-                    generated++;
-                }
+        // branching possible capture moves, follow moves
+        size_t saved_states = piece_jumps<Policy, index, 0>(state, cur_occupied, may_be_captured, captured)
+                            + piece_jumps<Policy, index, 1>(state, cur_occupied, may_be_captured, captured)
+                            + piece_jumps<Policy, index, 2>(state, cur_occupied, may_be_captured, captured)
+                            + piece_jumps<Policy, index, 3>(state, cur_occupied, may_be_captured, captured);
 
-                return 1;
-            } else {
-                return 0;
-            }
+        // nothing more can be captured
+        if (saved_states == 0) {
+            return save_captured(state, index, captured);
         }
 
         return saved_states;
     }
 
-    void next_king_moves(brd_index_t item_pos)
+    typedef size_t (_board_states_generator::*captures_kernel_t)(const board_state_t&, brd_map_t);
+
+    template<class Policy, int... indexes>
+    static constexpr auto make_captures_kernels(std::integer_sequence<int, indexes...>)
     {
-        brd_map_t available_dst = tables.king_move_masks[item_pos.index] - occupied;
+        return std::array<captures_kernel_t, sizeof...(indexes)>{&_board_states_generator::piece_captures<Policy, indexes>...};
+    }
 
-        if (!available_dst) {
-            return;
-        }
+    // entry point per square, each combines 4 per-direction kernels: 32*4 kernels per policy
+    template<class Policy>
+    static const std::array<captures_kernel_t, 32>& captures_kernels()
+    {
+        static constexpr auto kernels = make_captures_kernels<Policy>(std::make_integer_sequence<int, 32>{});
+        return kernels;
+    }
 
-        for (const auto& move_dir : tables.king_moves[item_pos.index]) {
-            for (brd_item_t dst : move_dir) {
-                if (!dst) {
-                    break;
-                }
-                if (available_dst.exist(dst)) {
-                    // do move - get new board state
-                    board_state_t next_state = do_move(cur_state, brd_item_t(item_pos), dst);
-                    // save new state
-                    _states.push_back(next_state);
-                    generated++;
-                } else {
-                    // capture handled in next_king_captures()
-                    // can't jump while move without capture
-                    break;
-                }
-            }
+    template<class Policy>
+    size_t next_captures(const board_state_t& state, brd_index_t item_pos, brd_map_t captured)
+    {
+        return (this->*captures_kernels<Policy>()[item_pos.index])(state, captured);
+    }
+
+    template<class Policy>
+    void next_moves(brd_index_t item_pos)
+    {
+        for (brd_index_t dst_index : moves_dst<Policy, side_i>(item_pos, occupied)) {
+            save_move(item_pos, dst_index);
         }
     }
 
@@ -471,51 +1163,78 @@ struct _board_states_generator
     brd_map_t occupied;
     board_state_t cur_state;
 
-    std::vector<board_state_t>& _states;
+    // square where current capture sequence started
+    brd_index_t chain_src;
+
+    // output: either boards or compact moves
+    std::vector<board_state_t>* _states = nullptr;
+    move_list_t* _moves = nullptr;
+    size_t out_base;
     size_t generated;
-    board_state_t bit_filter;
+
+    // capture sequences results cache, optional
+    chain_cache_t* chain_cache = nullptr;
+    bool recording = false;
+    size_t recorded;
+    std::array<chain_outcome_t, CHAIN_CACHE_OUTCOMES> recorded_outcomes;
+
+    // capture results set: 1 + index of saved state, 0 - empty slot,
+    // twice bigger than max number of results, so probe sequences are short
+    std::array<uint8_t, 2 * MAX_MOVES> dedup{};
+    bool dedup_clean;
+    // dedup_slot() takes top 8 bits of key
+    static_assert(std::tuple_size<decltype(dedup)>::value == 256);
+    // saved states never fill all slots, and 1 + index of the last one fits into slot
+    static_assert(MAX_MOVES < std::tuple_size<decltype(dedup)>::value);
+    static_assert(MAX_MOVES <= std::numeric_limits<uint8_t>::max());
 };
 
 
 // empirical 
 #define MAX_LEVEL_WIDTH 64
 
+// Owns output buffer and generators for both sides,
+// moving side is selected at compile time by template argument of gen_* methods.
 struct board_states_generator
 {
     board_states_generator() :
         states(MAX_LEVEL_WIDTH),
-        g(states)
+        white(states),
+        black(states)
     {}
     
     board_states_generator(board_states_generator&& other) :
         states(std::move(other.states)),
-        g(states)
+        white(states),
+        black(states)
     {}
 
     board_states_generator(const board_states_generator& other) :
         states(other.states),
-        g(states)
+        white(states),
+        black(states)
     {}
 
     board_states_generator& operator=(board_states_generator&&) = delete;
     board_states_generator& operator=(const board_states_generator&) = delete;
 
+    template<size_t side_i = 0>
     const std::vector<board_state_t>& gen_next_states(const board_state_t& brd)
     {
         states.clear();
-        g.gen_next_states(brd);
+        generator<side_i>().gen_next_states(brd);
         return states;
     }
 
+    template<size_t side_i = 0>
     const std::vector<board_state_t>& gen_item_next_states(const board_state_t& brd, brd_index_t item_pos)
     {
         states.clear();
 
+        auto& g = generator<side_i>();
         g.prepare(brd);
 
-        if (g.gen_captures()) {
-            states.clear();
-            g.prepare(brd);
+        if (can_capture<side_i>(brd)) {
             g.gen_item_captures(item_pos);
         } else {
             g.gen_item_moves(item_pos);
@@ -525,7 +1244,232 @@ struct board_states_generator
     }
 
 private:
+    template<size_t side_i>
+    _board_states_generator<side_i>& generator()
+    {
+        if constexpr (side_i == 0) {
+            return white;
+        } else {
+            return black;
+        }
+    }
+
     std::vector<board_state_t> states;
 
-    _board_states_generator g;
+    _board_states_generator<0> white;
+    _board_states_generator<1> black;
 };
+
+
+// Same as board_states_generator, but produces compact moves,
+// so caller materializes with apply() only boards it actually visits.
+struct moves_generator
+{
+    moves_generator() :
+        white(moves),
+        black(moves)
+    {}
+
+    moves_generator(const moves_generator& other) :
+        moves(other.moves),
+        white(moves),
+        black(moves)
+    {}
+
+    moves_generator& operator=(moves_generator&&) = delete;
+    moves_generator& operator=(const moves_generator&) = delete;
+
+    template<size_t side_i = 0>
+    const move_list_t& gen_next_moves(const board_state_t& brd)
+    {
+        moves.clear();
+        generator<side_i>().gen_next_states(brd);
+        return moves;
+    }
+
+    // number of next states, only capture results are saved into moves buffer
+    template<size_t side_i = 0>
+    size_t count_next_moves(const board_state_t& brd)
+    {
+        moves.clear();
+        return generator<side_i>().count_next_states(brd);
+    }
+
+    // capture sequences results cache for both sides, nullptr - disabled
+    void set_chain_cache(chain_cache_t* cache)
+    {
+        white.chain_cache = cache;
+        black.chain_cache = cache;
+    }
+
+    // all capture sequences, board must have captures available
+    template<size_t side_i = 0>
+    const move_list_t& gen_next_captures(const board_state_t& brd)
+    {
+        moves.clear();
+
+        auto& g = generator<side_i>();
+        g.prepare(brd);
+        g.gen_captures();
+
+        return moves;
+    }
+
+    template<size_t side_i = 0>
+    const move_list_t& gen_item_next_moves(const board_state_t& brd, brd_index_t item_pos)
+    {
+        moves.clear();
+
+        auto& g = generator<side_i>();
+        g.prepare(brd);
+
+        if (can_capture<side_i>(brd)) {
+            g.gen_item_captures(item_pos);
+        } else {
+            g.gen_item_moves(item_pos);
+        }
+
+        return moves;
+    }
+
+private:
+    template<size_t side_i>
+    _board_states_generator<side_i>& generator()
+    {
+        if constexpr (side_i == 0) {
+            return white;
+        } else {
+            return black;
+        }
+    }
+
+    move_list_t moves;
+
+    _board_states_generator<0> white;
+    _board_states_generator<1> black;
+};
+
+
+// Successors of board yielded one at a time - resumable state machine,
+// for searches that may not visit all branches.
+// Capture is mandatory, so captures availability is checked first. Capture sequences
+// are generated all at once into buffer of moves_generator, as equal results have to be deduplicated,
+// and then yielded from the buffer. Otherwise simple moves are taken one by one from destination masks,
+// in the same order as gen_next_moves() produces them.
+template<size_t side_i = 0>
+struct lazy_moves_t
+{
+    lazy_moves_t(moves_generator& g, const board_state_t& brd) :
+        occupied(brd.occupied())
+    {
+        if (can_capture<side_i>(brd)) {
+            captures = &g.gen_next_captures<side_i>(brd);
+            return;
+        }
+
+        const board_side_t& player = brd.sides[side_i];
+        brd_map_t items = player.items - player.kings;
+        brd_map_t empty = ~occupied.mask;
+        items_dst = {step<fwd_i>(items).select(empty), step<fwd_j>(items).select(empty)};
+        kings = player.kings;
+    }
+
+    // false if there are no more successors
+    bool next(move_t& m)
+    {
+        if (captures) {
+            if (captures_pos == captures->size()) {
+                return false;
+            }
+            m = (*captures)[captures_pos++];
+            return true;
+        }
+
+        if (items_dst[0]) {
+            m = item_move<fwd_i>(items_dst[0]);
+            return true;
+        }
+        if (items_dst[1]) {
+            m = item_move<fwd_j>(items_dst[1]);
+            return true;
+        }
+
+        // destinations of next king are computed when previous one is done
+        while (!kings_dst) {
+            if (!kings) {
+                return false;
+            }
+            king_pos = kings.lowest_index();
+            kings -= brd_item_t(king_pos);
+            kings_dst = moves_dst<king_policy, side_i>(king_pos, occupied);
+        }
+
+        brd_index_t dst = kings_dst.lowest_index();
+        kings_dst -= brd_item_t(dst);
+        m = {uint8_t(king_pos.index), uint8_t(dst.index), false, {}};
+        return true;
+    }
+
+    struct sentinel {};
+
+    struct iterator
+    {
+        lazy_moves_t* moves;
+        move_t m;
+        bool valid;
+
+        const move_t& operator*() const
+        {
+            return m;
+        }
+
+        iterator& operator++()
+        {
+            valid = moves->next(m);
+            return *this;
+        }
+
+        friend bool operator!=(const iterator& it, sentinel)
+        {
+            return it.valid;
+        }
+    };
+
+    iterator begin()
+    {
+        iterator it{this, {}, false};
+        it.valid = next(it.m);
+        return it;
+    }
+
+    sentinel end()
+    {
+        return {};
+    }
+
+private:
+    static constexpr size_t fwd_i = forward_directions<side_i>[0];
+    static constexpr size_t fwd_j = forward_directions<side_i>[1];
+
+    // simple item move to the lowest of destinations in direction dir_i
+    template<size_t dir_i>
+    move_t item_move(brd_map_t& dst_map)
+    {
+        brd_index_t dst = dst_map.lowest_index();
+        dst_map -= brd_item_t(dst);
+        brd_index_t src = step<opposite_direction(dir_i)>(brd_map_t(brd_item_t(dst))).lowest_index();
+        return {uint8_t(src.index), uint8_t(dst.index), king_row<side_i>.exist(brd_item_t(dst)), {}};
+    }
+
+    brd_map_t occupied;
+
+    const move_list_t* captures = nullptr;
+    size_t captures_pos = 0;
+
+    std::array<brd_map_t, 2> items_dst;
+    brd_map_t kings;
+    brd_map_t kings_dst;
+    brd_index_t king_pos;
+};
+
+ENGINE_NAMESPACE_END
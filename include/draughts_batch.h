@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstring>
+#include <vector>
+
+#include "draughts.h"
+
+ENGINE_NAMESPACE_BEGIN
+
+
+// Batch expansion of independent boards, e.g. BFS level.
+// Side-wide masks (captures availability, simple items moves) are computed for 8 boards at once:
+// 8 masks are single AVX2 register with -mavx2, or two SSE registers otherwise.
+// Only enumeration of moves and capture sequences stays per board.
+
+inline constexpr size_t batch_size = 8;
+
+typedef uint32_t masks_batch_t __attribute__((vector_size(batch_size * sizeof(uint32_t))));
+
+
+// Boards in structure-of-arrays form: separate arrays of kings and items masks of both sides.
+// Arrays are padded with empty boards up to multiple of batch_size.
+struct boards_soa_t
+{
+    boards_soa_t() = default;
+
+    explicit boards_soa_t(const std::vector<board_state_t>& boards)
+    {
+        reserve(boards.size());
+        for (const auto& b : boards) {
+            push_back(b);
+        }
+    }
+
+    void reserve(size_t n)
+    {
+        size_t padded = (n + batch_size - 1) / batch_size * batch_size;
+        for (size_t side_i = 0; side_i < 2; side_i++) {
+            kings[side_i].reserve(padded);
+            items[side_i].reserve(padded);
+        }
+    }
+
+    void push_back(const board_state_t& b)
+    {
+        if (count % batch_size == 0) {
+            for (size_t side_i = 0; side_i < 2; side_i++) {
+                kings[side_i].resize(count + batch_size, 0);
+                items[side_i].resize(count + batch_size, 0);
+            }
+        }
+        for (size_t side_i = 0; side_i < 2; side_i++) {
+            kings[side_i][count] = b.sides[side_i].kings.mask;
+            items[side_i][count] = b.sides[side_i].items.mask;
+        }
+        count++;
+    }
+
+    board_state_t operator[](size_t i) const
+    {
+        return {board_side_t{kings[0][i], items[0][i]}, board_side_t{kings[1][i], items[1][i]}};
+    }
+
+    size_t size() const
+    {
+        return count;
+    }
+
+    std::array<std::vector<uint32_t>, 2> kings;
+    std::array<std::vector<uint32_t>, 2> items;
+
+private:
+    size_t count = 0;
+};
+
+
+inline masks_batch_t load_batch(const std::vector<uint32_t>& masks, size_t first)
+{
+    masks_batch_t r;
+    memcpy(&r, masks.data() + first, sizeof(r));
+    return r;
+}
+
+inline bool any(masks_batch_t m)
+{
+    uint32_t r = 0;
+    for (size_t i = 0; i < batch_size; i++) {
+        r |= m[i];
+    }
+    return r != 0;
+}
+
+// Side-wide masks of boards [first, first + batch_size), the same as can_capture() and gen_moves() compute.
+template<size_t side_i>
+void gen_masks(const boards_soa_t& boards, size_t first, std::array<board_masks_t, batch_size>& out)
+{
+    constexpr size_t enemy_i = 1 - side_i;
+    constexpr size_t fwd_i = forward_directions<side_i>[0];
+    constexpr size_t fwd_j = forward_directions<side_i>[1];
+
+    masks_batch_t kings = load_batch(boards.kings[side_i], first);
+    masks_batch_t items = load_batch(boards.items[side_i], first);
+    masks_batch_t enemies = load_batch(boards.items[enemy_i], first);
+    masks_batch_t empty = ~(items | enemies);
+
+    // kings are also able to capture as simple items
+    masks_batch_t captures = jump_masks<0>(items, enemies, empty) | jump_masks<1>(items, enemies, empty)
+                           | jump_masks<2>(items, enemies, empty) | jump_masks<3>(items, enemies, empty);
+
+    // kings slides are the most expensive part, while kings are rare until endgame
+    if (any(kings)) {
+        captures |= jump_masks<0>(slide_masks<0>(kings, empty), enemies, empty)
+                  | jump_masks<1>(slide_masks<1>(kings, empty), enemies, empty)
+                  | jump_masks<2>(slide_masks<2>(kings, empty), enemies, empty)
+                  | jump_masks<3>(slide_masks<3>(kings, empty), enemies, empty);
+    }
+
+    masks_batch_t simple_items = items & ~kings;
+    masks_batch_t moves_i = step_masks<fwd_i>(simple_items) & empty;
+    masks_batch_t moves_j = step_masks<fwd_j>(simple_items) & empty;
+
+    for (size_t i = 0; i < batch_size; i++) {
+        out[i] = {captures[i] != 0, {moves_i[i], moves_j[i]}};
+    }
+}
+
+// Expand all boards, 'on_board' is called with number of next states of every board in order.
+template<size_t side_i, class F>
+void gen_next_states_batch(_board_states_generator<side_i>& g, const boards_soa_t& boards, F&& on_board)
+{
+    std::array<board_masks_t, batch_size> masks;
+
+    for (size_t first = 0; first < boards.size(); first += batch_size) {
+        gen_masks<side_i>(boards, first, masks);
+
+        size_t n = std::min(batch_size, boards.size() - first);
+        for (size_t i = 0; i < n; i++) {
+            on_board(g.gen_next_states(boards[first + i], masks[i]));
+        }
+    }
+}
+
+ENGINE_NAMESPACE_END
@@ -96,6 +96,18 @@ void free_board_tree(board_tree_node_t* tree);
 int verify_move(board_t initial_state, unsigned int from, unsigned int to);
 
 
+/**
+ * @brief The function that determines if the side to move has any possible move,
+ * without generation of moves.
+ * 
+ * @param state Board status.
+ * @param white_move The player to move. 0 - black, !0 - white.
+ * 
+ * @return 1 - if any move is possible, 0 - no moves available, the other side wins
+ */
+int has_any_legal_move(board_t state, int white_move);
+
+
 /**
  * @brief The function that generates the possible moves for a piece.
  * 
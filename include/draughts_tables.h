@@ -1,86 +1,105 @@
 #pragma once
 
-#include "draughts_types.h"
-
+#include <cstddef>
 
-template <size_t L1, size_t L2>
-constexpr auto product(const std::array<brd_2d_vector_t, L1>& x, const std::array<int, L2>& m)
-{
-    std::array<brd_2d_vector_t, L1*L2> r;
-    size_t i = 0;
-    for (brd_2d_vector_t x_i : x) {
-        for (int m_j : m) {
-            r[i++] = x_i * m_j;
-        }
-    }
-    return r;
-}
+#include "draughts_types.h"
 
+ENGINE_NAMESPACE_BEGIN
 
-inline const std::array<brd_2d_vector_t, 2> fwd_directions{up_left, up_right};
-inline const std::array<brd_2d_vector_t, 4> all_directions{up_left, up_right, down_left, down_right};
 
-inline const int item_jump_distance = 2;
+inline constexpr std::array<brd_2d_vector_t, 4> all_directions{up_left, up_right, down_left, down_right};
 
-inline const std::array<int, 7> king_move_distances{1, 2, 3, 4, 5, 6, 7};
-inline const std::array<int, 6> king_capture_distances{1, 2, 3, 4, 5, 6};
-inline const std::array<int, 6> king_jump_distances{2, 3, 4, 5, 6, 7};
 
+// Whole-map single step in direction all_directions[dir_i].
+// Every row holds 4 squares, so index offset of diagonal step depends on row parity:
+// even rows (x = 0, 2, 4, 6) and odd rows (x = 1, 3, 5, 7).
+// Items which step out of the board are dropped.
 
+inline constexpr uint32_t even_rows_mask = 0x0F0F0F0F;
+inline constexpr uint32_t odd_rows_mask = 0xF0F0F0F0;
+inline constexpr uint32_t left_col_mask = 0x01010101;   // x = 0
+inline constexpr uint32_t right_col_mask = 0x80808080;  // x = 7
 
-template<size_t L>
-constexpr auto gen_moves(const std::array<brd_2d_vector_t, L>& moves)
+// Raw masks version: M is uint32_t or SIMD vector of masks of several boards (see draughts_batch.h).
+template<size_t dir_i, class M>
+constexpr M step_masks(M m)
 {
-    std::array<std::array<brd_item_t, L>, 32> r{{}};
-
-    for (brd_index_t index = 0; index; ++index) {
-        auto start_position = brd_2d_vector_t(index);
-
-        size_t i = 0;
-        for (const auto& move : moves) {
-            auto dest = start_position + move;
-            if (dest) {
-                r[index.index][i++] = brd_item_t(dest);
-            }
-        }
+    static_assert(dir_i < 4);
+
+    if constexpr (dir_i == 0) {
+        // up_left
+        return ((m & (even_rows_mask & ~left_col_mask)) << 3) | ((m & odd_rows_mask) << 4);
+    } else if constexpr (dir_i == 1) {
+        // up_right
+        return ((m & even_rows_mask) << 4) | ((m & (odd_rows_mask & ~right_col_mask)) << 5);
+    } else if constexpr (dir_i == 2) {
+        // down_left
+        return ((m & (even_rows_mask & ~left_col_mask)) >> 5) | ((m & odd_rows_mask) >> 4);
+    } else {
+        // down_right
+        return ((m & even_rows_mask) >> 4) | ((m & (odd_rows_mask & ~right_col_mask)) >> 3);
     }
+}
 
-    return r;
+template<size_t dir_i>
+constexpr brd_map_t step(brd_map_t m)
+{
+    return step_masks<dir_i>(m.mask);
 }
 
-template<size_t L>
-constexpr auto gen_masks(const std::array<brd_2d_vector_t, L>& moves)
+constexpr size_t opposite_direction(size_t dir_i)
 {
-    std::array<brd_map_t, 32> r{{}};
+    return 3 - dir_i;
+}
 
-    for (brd_index_t index = 0; index; ++index) {
-        auto start_position = brd_2d_vector_t(index);
+// Whole-map jump over single square in direction all_directions[dir_i]:
+// map of jumping items -> map of destinations, if jump over item from 'over' map is possible.
+template<size_t dir_i, class M>
+constexpr M jump_masks(M m, M over, M empty)
+{
+    return step_masks<dir_i>(step_masks<dir_i>(m) & over) & empty;
+}
 
-        for (const auto& move : moves) {
-            auto dest = start_position + move;
-            if (dest) {
-                r[index.index] += brd_item_t(dest);
-            }
-        }
+template<size_t dir_i>
+constexpr brd_map_t jump(brd_map_t m, brd_map_t over, brd_map_t empty)
+{
+    return jump_masks<dir_i>(m.mask, over.mask, empty.mask);
+}
+
+// Whole-map slide of kings in direction all_directions[dir_i] over empty squares:
+// map of kings -> map of kings and all empty squares they can reach.
+// Five steps are enough for captures: king can slide at most 5 squares
+// and still have 2 more squares for captured item and jump destination.
+template<size_t dir_i, size_t max_distance = 5, class M>
+constexpr M slide_masks(M m, M empty)
+{
+    for (size_t i = 0; i < max_distance; i++) {
+        m |= step_masks<dir_i>(m) & empty;
     }
+    return m;
+}
 
-    return r;
+template<size_t dir_i, size_t max_distance = 5>
+constexpr brd_map_t slide(brd_map_t m, brd_map_t empty)
+{
+    return slide_masks<dir_i, max_distance>(m.mask, empty.mask);
 }
 
+
+
 template<size_t L>
-constexpr auto gen_captures(const std::array<brd_2d_vector_t, L>& captures)
+constexpr auto gen_rays(const std::array<brd_2d_vector_t, L>& directions)
 {
-    std::array<std::array<std::pair<brd_item_t, brd_index_t>, L>, 32> r{{std::pair<brd_item_t, brd_index_t>{{}, {}}}};
+    std::array<std::array<brd_map_t, L>, 32> r{{}};
 
     for (brd_index_t index = 0; index; ++index) {
         auto start_position = brd_2d_vector_t(index);
 
-        size_t i = 0;
-        for (const auto& c : captures) {
-            brd_2d_vector_t cap = start_position + c;
-            brd_2d_vector_t dst = start_position + (c * item_jump_distance);
-            if (dst) {
-                r[index.index][i++] = std::pair<brd_item_t, brd_index_t>(cap, dst);
+        for (size_t dir_i = 0; dir_i < L; dir_i++) {
+            auto dst = start_position + directions[dir_i];
+            while (dst) {
+                r[index.index][dir_i] += brd_item_t(dst);
+                dst += directions[dir_i];
             }
         }
     }
@@ -88,101 +107,108 @@ constexpr auto gen_captures(const std::array<brd_2d_vector_t, L>& captures)
     return r;
 }
 
-template<size_t L1, size_t L2>
-constexpr auto gen_king_moves(const std::array<brd_2d_vector_t, L1>& directions, const std::array<int, L2>& distances)
-{
-    std::array<std::array<std::array<brd_item_t, L2>, L1>, 32> r{{{}}};
-
-    for (brd_index_t index = 0; index; ++index) {
-        auto start_position = brd_2d_vector_t(index);
 
-        for (size_t dir_i = 0; dir_i < L1; dir_i++){
+// Diagonal rays: directions up_left and up_right go to higher indexes,
+// down_left and down_right - to lower indexes,
+// so the nearest item on a ray is the lowest or the highest set bit of the ray.
 
-            auto direction = directions[dir_i];
+template<size_t dir_i>
+constexpr bool ray_goes_up()
+{
+    return dir_i < 2;
+}
 
-            size_t dist_i = 0;
-            for (int distance : distances) {
-                auto dst = start_position + (direction * distance);
-                if (dst) {
-                    r[index.index][dir_i][dist_i++] = brd_item_t(dst);
-                }
-            }
-        }
+// nearest to ray start occupied square, or empty map
+template<size_t dir_i>
+constexpr brd_map_t first_blocker(brd_map_t ray, brd_map_t occupied)
+{
+    uint32_t b = ray.mask & occupied.mask;
+    if constexpr (ray_goes_up<dir_i>()) {
+        return b & (0u - b);
+    } else {
+        return b ? (0x80000000u >> __builtin_clz(b)) : 0u;
     }
-
-    return r;
 }
 
-template<size_t L1, size_t L2>
-constexpr auto gen_king_captures(const std::array<brd_2d_vector_t, L1>& directions, const std::array<int, L2>& capture_distances)
+// squares of the ray before the blocker, whole ray if there is no blocker
+template<size_t dir_i>
+constexpr brd_map_t ray_before(brd_map_t ray, brd_map_t blocker)
 {
-    std::array<std::array<std::array<std::pair<brd_item_t, std::array<brd_index_t, L2>>, L2>, L1>, 32>
-    r{{{std::pair<brd_item_t, std::array<brd_index_t, 6>>{{}, {{}}}}}};
-
-    // for every item position
-    for (brd_index_t index = 0; index; ++index) {
-        auto start_position = brd_2d_vector_t(index);
-
-        // for every directon from this position
-        for (size_t dir_i = 0; dir_i < L1; dir_i++){
-
-            auto direction = directions[dir_i];
-
-            // fill possible captures for this direction
-            int capture_i = 0;
-            for (int capture_distance : capture_distances) {
-
-                auto capture = start_position + (direction * capture_distance);
-                auto destination = start_position + (direction * (capture_distance + 1));
-
-                if (destination) {
-                    r[index.index][dir_i][capture_i].first = brd_item_t(capture);
-
-                    // and fill possible jump destinations for this capture
-                    int jump_i = 0;
-                    while (destination) {
-                        r[index.index][dir_i][capture_i].second[jump_i++] = brd_index_t(destination);
-                        destination += direction;
-                    }
-
-                    capture_i++;
-                }
-            }
-        }
+    if constexpr (ray_goes_up<dir_i>()) {
+        return ray.mask & (blocker.mask - 1);
+    } else {
+        return blocker ? ray.mask & ~(blocker.mask | (blocker.mask - 1)) : ray.mask;
     }
+}
 
-    return r;
+// squares of the ray behind the blocker
+template<size_t dir_i>
+constexpr brd_map_t ray_beyond(brd_map_t ray, brd_map_t blocker)
+{
+    return ray.mask & ~(ray_before<dir_i>(ray, blocker).mask | blocker.mask);
 }
 
 //TODO: Optimizations:
 // - binary serach of moves/captures: whole bitmap -> half(forward+backward or cross) -> 4 directions
-// - 32*4 different functions, maybe generated with templates
-// - utilize the diagonal move symmetry, e.g. detect possible moves for multiple items same time
 
-//TODO: Generalization: generate same structs for items and kings, use same function for handling but different control structure
 
-inline const struct tables_t
+// All moves of simple items and their captures are whole-map shifts (step, jump),
+// and captures kernels have their masks as compile-time constants (see draughts.h),
+// so the only table needed at runtime is kings diagonal rays.
+struct tables_t
 {
-    //TODO: rename move to dst, capture_move -> jump_dst
+    // item index -> 4 directions -> all squares on diagonal ray from item to the board edge
+    std::array<std::array<brd_map_t, 4>, 32> king_rays;
+};
 
-    std::array<std::array<brd_item_t, 2>, 32> fwd_destinations = gen_moves<2>(fwd_directions);
-    std::array<brd_map_t, 32> fwd_dst_masks = gen_masks<2>(fwd_directions);
+constexpr tables_t gen_tables()
+{
+    return {gen_rays<4>(all_directions)};
+}
 
-    // first is capture, second is move destination index
-    std::array<std::array<std::pair<brd_item_t, brd_index_t>, 4>, 32> captures = gen_captures<4>(all_directions);
-    std::array<brd_map_t, 32> capture_move_masks = gen_masks<4>(product(all_directions, std::array<int, 1>{2}));
-    std::array<brd_map_t, 32> capture_masks = gen_masks<4>(all_directions);
+inline constexpr tables_t tables = gen_tables();
 
+// 32 squares * 4 directions * 4 bytes = 512 bytes, 8 cache lines of 64 bytes.
+// Together with item capture kernels table (32 member function pointers, 512 bytes)
+// whole working set of generator is about 1 KB.
+static_assert(sizeof(tables_t) == 512);
 
-    std::array<std::array<std::array<brd_item_t, 7>, 4>, 32> king_moves = gen_king_moves<4, 7>(all_directions, king_move_distances);
-    std::array<brd_map_t, 32> king_move_masks = gen_masks<28>(product(all_directions, king_move_distances));
 
-    // item index -> 4 directions -> list of pairs (capture mask, list of possible jump destination indexes)
-    std::array<std::array<std::array<std::pair<brd_item_t, std::array<brd_index_t, 6>>, 6>, 4>, 32>
-    king_captures = gen_king_captures<4, 6>(all_directions, king_capture_distances);
+// rays built from 2-dimentional geometry must agree with whole-map shifts:
+// ray from square = next square in direction + ray from next square
+template<size_t dir_i>
+constexpr bool check_rays(const tables_t& t)
+{
+    for (int index = 0; index < 32; index++) {
+        brd_map_t next = step<dir_i>(brd_map_t(1u << index));
+        uint32_t expected = next ? next.mask | t.king_rays[__builtin_ctz(next.mask)][dir_i].mask : 0;
+        if (t.king_rays[index][dir_i].mask != expected) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(check_rays<0>(tables) && check_rays<1>(tables) && check_rays<2>(tables) && check_rays<3>(tables));
 
-    std::array<brd_map_t, 32> king_capture_move_masks = gen_masks<24>(product(all_directions, king_jump_distances));
-    std::array<brd_map_t, 32> king_capture_masks = gen_masks<24>(product(all_directions, king_capture_distances));
+// every square is on rays of exactly 4 directions, which are mirrored:
+// if square b is on ray from a, then a is on opposite ray from b
+constexpr bool check_rays_symmetry(const tables_t& t)
+{
+    for (int a = 0; a < 32; a++) {
+        for (size_t dir_i = 0; dir_i < 4; dir_i++) {
+            for (int b = 0; b < 32; b++) {
+                bool a_b = t.king_rays[a][dir_i].mask & (1u << b);
+                bool b_a = t.king_rays[b][opposite_direction(dir_i)].mask & (1u << a);
+                if (a_b != b_a) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
 
-} tables;
+static_assert(check_rays_symmetry(tables));
 
+ENGINE_NAMESPACE_END
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+
+// dts search is built for several instruction sets (see src/dts_search.cc and engine_isa.h),
+// main() selects one variant at startup, so only plain types cross the boundary.
+
+struct dts_options_t
+{
+    std::string command;
+    std::string cache_impl;
+    size_t max_depth;
+    std::chrono::system_clock::time_point run_until;
+    size_t max_width;
+    bool randomize;
+    bool cache;
+    bool lazy;
+    bool chain_cache;
+    bool in_place;
+    bool iterative;
+    size_t cache_mb;
+    bool verbose;
+    bool print_cache_hits;
+    bool print_wins;
+    size_t n_threads;
+    // checkpoint file, empty - no checkpoints
+    std::string checkpoint;
+    std::chrono::system_clock::duration checkpoint_period;
+    // bucket cache is saved into checkpoint
+    bool checkpoint_cache;
+    // checkpoint file to continue search from, search options are restored from it
+    std::string resume;
+};
+
+struct dts_variant_t
+{
+    const char* isa;
+    // command and cache implementation must be valid
+    void (*run)(const dts_options_t& opts);
+    // safe to call from signal handler
+    void (*stop)();
+};
+
+extern const dts_variant_t dts_variant_scalar;
+#if defined(__x86_64__)
+extern const dts_variant_t dts_variant_bmi2;
+extern const dts_variant_t dts_variant_avx2;
+#endif
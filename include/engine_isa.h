@@ -0,0 +1,21 @@
+#pragma once
+
+// The same engine code can be compiled for several instruction sets into one binary,
+// e.g. dts search is built for scalar, BMI2 and AVX2 and selected at startup (see src/dts_search.cc).
+// Each build puts engine into its own inline namespace, so copies of non-inlined functions
+// compiled with different flags never clash, while code using engine doesn't name the namespace.
+// Every header with inline or template code used by search (utils.h, caches, checkpoint.h) is inside of it too,
+// outside are only types crossing the boundary between variants (dts_search.h) and C API.
+// ENGINE_ISA is defined by build for every variant, default is the baseline of target architecture.
+
+#ifndef ENGINE_ISA
+#define ENGINE_ISA scalar
+#endif
+
+#define ENGINE_ISA_CONCAT_(a, b) a##b
+#define ENGINE_ISA_CONCAT(a, b) ENGINE_ISA_CONCAT_(a, b)
+#define ENGINE_ISA_STR_(isa) #isa
+#define ENGINE_ISA_STR(isa) ENGINE_ISA_STR_(isa)
+
+#define ENGINE_NAMESPACE_BEGIN inline namespace ENGINE_ISA_CONCAT(isa_, ENGINE_ISA) {
+#define ENGINE_NAMESPACE_END }
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <Judy.h>
+#include <cstdint>
+#include <utility>
+
+#include "engine_isa.h"
+
+ENGINE_NAMESPACE_BEGIN
+
+// 128-bit keys to word values: JudyL of first halves of keys to JudyL of second halves.
+struct judy_128_map
+{
+    // insert or get, value of inserted key is 0
+    std::pair<Word_t*, bool> insert(const std::pair<uint64_t, uint64_t>& k)
+    {
+        void** pv = JudyLIns(&array, k.first, nullptr);
+
+        if (pv == PJERR) {
+            return {nullptr, false};
+        }
+
+        // value of existing key can be 0 too, so new one is detected by lookup
+        void** pw = JudyLGet(*pv, k.second, nullptr);
+        if (pw != nullptr) {
+            return {reinterpret_cast<Word_t*>(pw), false};
+        }
+
+        pw = JudyLIns(pv, k.second, nullptr);
+
+        if (pw == PJERR) {
+            return {nullptr, false};
+        }
+
+        _size++;
+
+        return {reinterpret_cast<Word_t*>(pw), true};
+    }
+
+    size_t size() const
+    {
+        return _size;
+    }
+
+    ~judy_128_map()
+    {
+        uint64_t index = 0;
+        void** pv = JudyLFirst(array, &index, nullptr);
+        while (pv != nullptr) {
+            JudyLFreeArray(pv, nullptr);
+            pv = JudyLNext(array, &index, nullptr);
+        }
+        JudyLFreeArray(&array, nullptr);
+    }
+
+private:
+    void* array = nullptr;
+    size_t _size = 0;
+};
+
+ENGINE_NAMESPACE_END
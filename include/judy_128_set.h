@@ -5,6 +5,10 @@
 #include <cstdio>
 #include <utility>
 
+#include "engine_isa.h"
+
+ENGINE_NAMESPACE_BEGIN
+
 struct judy_128_set
 {
     std::pair<void*, bool> insert(const std::pair<uint64_t, uint64_t>& v)
@@ -64,3 +68,4 @@ private:
     size_t _size = 0;
 };
 
+ENGINE_NAMESPACE_END
@@ -1,29 +1,40 @@
 #pragma once
 
+#include <condition_variable>
+#include <exception>
+#include <functional>
 #include <future>
+#include <mutex>
 
 #include "dfs.h"
+#include "draughts_batch.h"
 
+ENGINE_NAMESPACE_BEGIN
 
+
+template<size_t side_i>
 std::vector<board_state_t> do_bfs_level(const std::vector<board_state_t>& boards, size_t depth, stats& sts)
 {
     std::vector<board_state_t> next_boards; 
-    _board_states_generator g(next_boards);
+    _board_states_generator<side_i> g(next_boards);
 
     next_boards.reserve(boards.size() * 8); // 8 - empirical multiplier
 
-    for (const auto& brd : boards) {
-        size_t w = g.gen_next_states(brd);
+    // side-wide masks are computed for batches of boards
+    gen_next_states_batch(g, boards_soa_t(boards), [&sts, depth] (size_t w) {
         sts.consume_level_width(w, depth);
-    }
+    });
 
     return next_boards;
 }
 
-void rotate_level(std::vector<board_state_t>& boards)
+// boards are in absolute orientation, even depth - white moves
+std::vector<board_state_t> do_bfs_level(const std::vector<board_state_t>& boards, size_t depth, stats& sts)
 {
-    for (auto& b : boards) {
-        b = rotate(b);
+    if (depth % 2 == 0) {
+        return do_bfs_level<0>(boards, depth, sts);
+    } else {
+        return do_bfs_level<1>(boards, depth, sts);
     }
 }
 
@@ -41,8 +52,8 @@ struct MTDFS
     {
         printf("Multi-thread DFS\n");
 
-        stats sts;
-        auto started = Clock::now();
+        started = Clock::now();
+        bfs_sts = stats();
 
         std::vector<std::future<dfs_result_t>> results;
 
@@ -52,9 +63,8 @@ struct MTDFS
         size_t min_level_size = workers.size() * min_initial_boards_per_thread;
 
         while (level.size() < min_level_size) {
-            level = do_bfs_level(level, depth, sts);
+            level = do_bfs_level(level, depth, bfs_sts);
             depth++;
-            rotate_level(level);
         }
         printf("initial BFS finished\ndepth: %lu\nboards: %lu\n", depth, level.size());
 
@@ -62,15 +72,155 @@ struct MTDFS
 
         size_t i = 0;
         for (auto& v : splitted_level) {
-            results.emplace_back(
-                std::async(
-                    std::launch::async,
-                    workers[i].get_callable(std::move(v), depth)
-                )
-            );
+            if (checkpoint) {
+                workers[i].set_roots(v, depth);
+            } else {
+                results.emplace_back(
+                    std::async(
+                        std::launch::async,
+                        workers[i].get_callable(std::move(v), depth)
+                    )
+                );
+            }
             i++;
         }
 
+        if (checkpoint) {
+            // initial boards of workers are saved before start
+            checkpoint();
+            for (size_t k = 0; k < i; k++) {
+                continue_worker(results, k);
+            }
+        }
+
+        wait_results(results);
+    }
+
+    // continue search loaded from checkpoint, see load()
+    void resume()
+    {
+        printf("Multi-thread DFS, resumed: %.0fs elapsed before\n", total_seconds(elapsed_before));
+
+        started = Clock::now() - elapsed_before;
+
+        std::vector<std::future<dfs_result_t>> results;
+        for (size_t i = 0; i < workers.size(); i++) {
+            continue_worker(results, i);
+        }
+
+        wait_results(results);
+    }
+
+    // Periodic checkpoints, see DFS::set_checkpoint(): every worker is parked at consistent state of its search,
+    // when all running workers are parked, 'write' is called from thread of do_search() or resume().
+    void set_checkpoint(std::function<void()> write, Clock::duration period)
+    {
+        checkpoint = std::move(write);
+        for (auto& w : workers) {
+            w.set_checkpoint([this] () { park(); }, period);
+        }
+    }
+
+    // Stats of initial BFS and state of every worker, workers must be parked or finished.
+    // Workers are saved directly into checkpoint, their caches are not copied.
+    void save(checkpoint_writer& w) const
+    {
+        w.put(Clock::now() - started);
+        bfs_sts.save(w);
+        w.put(workers.size());
+        for (const auto& worker : workers) {
+            worker.save(w);
+        }
+    }
+
+    void load(checkpoint_reader& r)
+    {
+        elapsed_before = r.get<Clock::duration>();
+        bfs_sts.load(r);
+        if (r.get<size_t>() != workers.size()) {
+            throw checkpoint_error("checkpoint doesn't match search configuration");
+        }
+        for (auto& worker : workers) {
+            worker.load(r);
+        }
+    }
+
+private:
+    // worker is active until its search returns
+    void continue_worker(std::vector<std::future<dfs_result_t>>& results, size_t i)
+    {
+        {
+            std::lock_guard<std::mutex> lock(checkpoint_mutex);
+            active++;
+        }
+        results.emplace_back(std::async(std::launch::async, [this, i] () {
+            try {
+                auto r = workers[i].continue_search();
+                leave();
+                return r;
+            } catch (...) {
+                leave();
+                throw;
+            }
+        }));
+    }
+
+    void leave()
+    {
+        std::lock_guard<std::mutex> lock(checkpoint_mutex);
+        active--;
+        checkpoint_cv.notify_all();
+    }
+
+    // called from worker thread, it waits until checkpoint is written
+    void park()
+    {
+        std::unique_lock<std::mutex> lock(checkpoint_mutex);
+        size_t generation = checkpoint_generation;
+        parked++;
+        checkpoint_cv.notify_all();
+        checkpoint_cv.wait(lock, [this, generation] () { return checkpoint_generation != generation; });
+    }
+
+    // checkpoint is written when all running workers are parked
+    void write_checkpoints()
+    {
+        std::unique_lock<std::mutex> lock(checkpoint_mutex);
+        while (true) {
+            checkpoint_cv.wait(lock, [this] () { return active == 0 || parked == active; });
+            if (active == 0) {
+                return;
+            }
+
+            lock.unlock();
+            std::exception_ptr error;
+            try {
+                checkpoint();
+            } catch (...) {
+                // search is stopped, workers are finished before error is thrown further
+                error = std::current_exception();
+                g_running = false;
+            }
+            lock.lock();
+
+            parked = 0;
+            checkpoint_generation++;
+            checkpoint_cv.notify_all();
+
+            if (error) {
+                lock.unlock();
+                std::rethrow_exception(error);
+            }
+        }
+    }
+
+    void wait_results(std::vector<std::future<dfs_result_t>>& results)
+    {
+        if (checkpoint) {
+            write_checkpoints();
+        }
+
+        stats sts = bfs_sts;
         bool completed = true;
         for (auto& f : results) {
             auto r = f.get();
@@ -78,17 +228,26 @@ struct MTDFS
             completed = completed & std::get<1>(r);
         }
 
-        //TODO: progress
-
         printf("\n%s\n", completed ? "Completed!" : "Terminated.");
         sts.print(started, workers.size());
 
         //TODO: fater destroy cache
     }
 
-private:
     size_t min_initial_boards_per_thread;
 
     std::vector<Worker> workers;
+
+    Clock::time_point started;
+    Clock::duration elapsed_before{0};
+    stats bfs_sts;
+
+    std::function<void()> checkpoint;
+    std::mutex checkpoint_mutex;
+    std::condition_variable checkpoint_cv;
+    size_t active = 0;
+    size_t parked = 0;
+    size_t checkpoint_generation = 0;
 };
 
+ENGINE_NAMESPACE_END
@@ -0,0 +1,280 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "dfs.h"
+#include "bucket_cache.h"
+
+ENGINE_NAMESPACE_BEGIN
+
+
+// Counts of tree under board, the same as stats of full DFS without cache:
+// nodes - boards after every move, leaves at max depth are counted both in nodes and in depth limits.
+struct perft_t
+{
+    size_t nodes = 0;
+    size_t w_wins = 0;
+    size_t b_wins = 0;
+    size_t depth_limits = 0;
+
+    perft_t& operator+=(const perft_t& other)
+    {
+        nodes += other.nodes;
+        w_wins += other.w_wins;
+        b_wins += other.b_wins;
+        depth_limits += other.depth_limits;
+        return *this;
+    }
+};
+
+
+// Fixed-size memo of subtree counts, the same way as bucket_cache:
+// 4 entries in bucket selected by hash of board and remaining depth,
+// board is verified by the whole Zobrist key and bucket_cache::check() of board bits.
+// Full bucket replaces entry with the least remaining depth, its subtree is the cheapest to count again.
+struct perft_cache
+{
+    struct entry_t
+    {
+        uint64_t key;
+        uint32_t check;
+        // 0 - empty entry
+        uint32_t remaining;
+        perft_t counts;
+    };
+
+    struct alignas(64) bucket_t
+    {
+        std::array<entry_t, 4> entries;
+    };
+
+    static_assert(sizeof(bucket_t) == 192);
+
+    // the largest power of 2 number of buckets fitting into 'bytes', no buckets - nothing is memoized
+    void resize(size_t bytes)
+    {
+        size_t n = bytes >= sizeof(bucket_t) ? 1 : 0;
+        while (n > 0 && n * 2 * sizeof(bucket_t) <= bytes) {
+            n *= 2;
+        }
+        buckets.assign(n, bucket_t{});
+        mask = n - 1;
+    }
+
+    const perft_t* find(const std::pair<uint64_t, uint64_t>& brd, uint64_t key, size_t remaining) const
+    {
+        if (buckets.empty()) {
+            return nullptr;
+        }
+        uint32_t c = bucket_cache::check(brd);
+        for (const entry_t& e : buckets[index(key, remaining)].entries) {
+            if (e.remaining == remaining && e.key == key && e.check == c) {
+                return &e.counts;
+            }
+        }
+        return nullptr;
+    }
+
+    void insert(const std::pair<uint64_t, uint64_t>& brd, uint64_t key, size_t remaining, const perft_t& counts)
+    {
+        if (buckets.empty()) {
+            return;
+        }
+        bucket_t& b = buckets[index(key, remaining)];
+
+        entry_t* victim = &b.entries[0];
+        for (entry_t& e : b.entries) {
+            if (e.remaining < victim->remaining) {
+                victim = &e;
+            }
+        }
+        if (victim->remaining > remaining) {
+            return;
+        }
+
+        if (victim->remaining == 0) {
+            _size++;
+        } else {
+            _replaced++;
+        }
+        *victim = {key, bucket_cache::check(brd), uint32_t(remaining), counts};
+    }
+
+    size_t size() const
+    {
+        return _size;
+    }
+
+    size_t replaced() const
+    {
+        return _replaced;
+    }
+
+    size_t capacity() const
+    {
+        return buckets.size() * 4;
+    }
+
+private:
+    size_t index(uint64_t key, size_t remaining) const
+    {
+        return (key ^ (remaining * 0x9E3779B97F4A7C15ull)) & mask;
+    }
+
+    std::vector<bucket_t> buckets;
+    size_t mask = 0;
+    size_t _size = 0;
+    size_t _replaced = 0;
+};
+
+
+// Full tree counting with subtrees memoized by (board, remaining depth):
+// board reached by different move orders at the same depth is expanded only once.
+// Memo is fixed-size table of 'cache_bytes', 0 - no memoization.
+// Boards two moves before limit are not memoized: their subtrees are cheaper to count again
+// than to keep, memoizing them doubles time and triples memory.
+struct PERFT
+{
+    PERFT(size_t max_depth, Clock::time_point run_until, size_t cache_bytes) :
+        max_depth(max_depth),
+        run_until(run_until),
+        stack(max_depth)
+    {
+        memo.resize(cache_bytes);
+    }
+
+    // counts of unfinished search are not valid, see running()
+    perft_t count(const board_state_t& brd)
+    {
+        _running = true;
+        if (max_depth == 0) {
+            return {};
+        }
+        return perft<0>(stack.data(), keyed_board_t(brd), max_depth);
+    }
+
+    bool running() const
+    {
+        return _running;
+    }
+
+    perft_t do_search(const board_state_t& brd)
+    {
+        auto tp = Clock::to_time_t(run_until);
+        std::cout << "PERFT, max_depth=" << max_depth
+                  << ", run_until=" << std::put_time(std::localtime(&tp), "%F %T")
+                  << ", memo capacity=" << memo.capacity()
+                  << std::endl;
+
+        printf("\n  Initial board:\n");
+        print(brd);
+
+        auto started = Clock::now();
+
+        perft_t r = count(brd);
+
+        float elapsed_s = total_seconds(Clock::now() - started);
+        printf("\n%s\n", _running ? "Completed!" : "Terminated.");
+        printf("\nelapsed: %fs\n", elapsed_s);
+        if (!_running) {
+            // counts of unfinished subtrees are not valid
+            return {};
+        }
+
+        printf("total boards: %lu\n", r.nodes);
+        printf("rate: %.2f Mboards/s\n", r.nodes / elapsed_s / 1000000);
+        printf("W wins: %lu; B wins: %lu; depth limits: %lu\n", r.w_wins, r.b_wins, r.depth_limits);
+
+        printf("memoized subtrees: %lu; replaced: %lu; lookups: %lu; hits: %.2f%%\n",
+               memo.size(), memo.replaced(), lookups, lookups > 0 ? 100.0 * hits / lookups : 0.0);
+
+        return r;
+    }
+
+private:
+    // side_i is going to move, remaining > 0
+    template<size_t side_i>
+    perft_t perft(moves_generator* sp, const keyed_board_t& brd, size_t remaining)
+    {
+        perft_t r;
+
+        if (remaining == 1) {
+            // every next board is a leaf at depth limit
+            r.nodes = sp->template count_next_moves<side_i>(brd.state);
+            r.depth_limits = r.nodes;
+            if (r.nodes == 0) {
+                win<side_i>(r);
+            }
+            return r;
+        }
+
+        auto board = std::pair<uint64_t, uint64_t>(brd.state);
+        bool memoized = remaining >= min_memoized_depth;
+
+        if (memoized) {
+            lookups++;
+            if (const perft_t* counts = memo.find(board, brd.key, remaining)) {
+                hits++;
+                return *counts;
+            }
+        }
+
+        handle_status();
+        if (!_running) {
+            return r;
+        }
+
+        const move_list_t& v = sp->template gen_next_moves<side_i>(brd.state);
+        r.nodes = v.size();
+        if (v.size() == 0) {
+            win<side_i>(r);
+        }
+
+        for (const auto& m : v) {
+            r += perft<1 - side_i>(sp + 1, apply<side_i>(brd, m), remaining - 1);
+        }
+
+        // only completed subtrees
+        if (memoized && _running) {
+            memo.insert(board, brd.key, remaining, r);
+        }
+        return r;
+    }
+
+    // side_i has no moves, the same as stats::consume_level_width()
+    template<size_t side_i>
+    static void win(perft_t& r)
+    {
+        if constexpr (side_i == 0) {
+            r.b_wins++;
+        } else {
+            r.w_wins++;
+        }
+    }
+
+    void handle_status()
+    {
+        if (++expanded % status_check_step != 0) {
+            return;
+        }
+        _running = Clock::now() < run_until && g_running;
+    }
+
+    static constexpr size_t status_check_step = 1 << 16;
+    static constexpr size_t min_memoized_depth = 3;
+
+    size_t max_depth;
+    Clock::time_point run_until;
+
+    std::vector<moves_generator> stack;
+    // (board, remaining depth) -> counts of its subtree
+    perft_cache memo;
+
+    bool _running = true;
+    size_t expanded = 0;
+    size_t lookups = 0;
+    size_t hits = 0;
+};
+
+ENGINE_NAMESPACE_END
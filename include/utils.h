@@ -10,8 +10,11 @@
 #include <boost/range/adaptor/map.hpp>
 #include <boost/algorithm/string/join.hpp>
 
+#include "engine_isa.h"
+
 using namespace std::literals::chrono_literals;
 
+ENGINE_NAMESPACE_BEGIN
 
 
 template<typename T>
@@ -121,3 +124,4 @@ readable_duration_t<clock>::units =
     {"d", 24h}
 };
 
+ENGINE_NAMESPACE_END
@@ -0,0 +1,678 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+#include <chrono>
+
+#if defined(__SSSE3__)
+#include <immintrin.h>
+#endif
+
+#include "utils.h"
+#include "draughts.h"
+#include "draughts_batch.h"
+#include "capture_explorer.h"
+#include "dfs.h"
+
+using BenchClock = std::chrono::steady_clock;
+
+// results of compared variants must be the same, bench fails otherwise
+bool failed = false;
+
+void report_mismatch(const char* what)
+{
+    printf("  ERROR: %s mismatch\n", what);
+    failed = true;
+}
+
+
+
+// Random boards with [min_items, max_items] items per side,
+// every item becomes king with probability king_p.
+// Simple items are never placed on own king row.
+std::vector<board_state_t> gen_boards(size_t count, int min_items, int max_items, double king_p, uint32_t seed = 1)
+{
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> n_items(min_items, max_items);
+    std::uniform_int_distribution<int> square(0, 31);
+    std::bernoulli_distribution is_king(king_p);
+
+    std::vector<board_state_t> r;
+    r.reserve(count);
+
+    while (r.size() < count) {
+        board_state_t brd;
+        for (size_t side = 0; side < 2; side++) {
+            int n = n_items(rng);
+            while (n > 0) {
+                auto item = brd_item_t(brd_index_t(square(rng)));
+                if (brd.occupied().exist(item)) {
+                    continue;
+                }
+                // side 0 is promoted on top row, side 1 - on bottom row
+                bool king_row = side == 0 ? item.is_on_king_row() : (item.mask & 0xF) != 0;
+                bool king = king_row || is_king(rng);
+                brd.sides[side].items += item;
+                if (king) {
+                    brd.sides[side].kings += item;
+                }
+                n--;
+            }
+        }
+        r.push_back(brd);
+    }
+
+    return r;
+}
+
+
+// Per-square kings tables with sentinel entries, the way they were before ray masks.
+
+auto gen_king_moves()
+{
+    std::array<std::array<std::array<brd_item_t, 7>, 4>, 32> r{{{}}};
+
+    for (brd_index_t index = 0; index; ++index) {
+        auto start_position = brd_2d_vector_t(index);
+
+        for (size_t dir_i = 0; dir_i < 4; dir_i++){
+            size_t dist_i = 0;
+            for (int distance = 1; distance <= 7; distance++) {
+                auto dst = start_position + (all_directions[dir_i] * distance);
+                if (dst) {
+                    r[index.index][dir_i][dist_i++] = brd_item_t(dst);
+                }
+            }
+        }
+    }
+
+    return r;
+}
+
+auto gen_king_captures()
+{
+    std::array<std::array<std::array<std::pair<brd_item_t, std::array<brd_index_t, 6>>, 6>, 4>, 32>
+    r{{{std::pair<brd_item_t, std::array<brd_index_t, 6>>{{}, {{}}}}}};
+
+    for (brd_index_t index = 0; index; ++index) {
+        auto start_position = brd_2d_vector_t(index);
+
+        for (size_t dir_i = 0; dir_i < 4; dir_i++){
+            auto direction = all_directions[dir_i];
+
+            int capture_i = 0;
+            for (int capture_distance = 1; capture_distance <= 6; capture_distance++) {
+                auto capture = start_position + (direction * capture_distance);
+                auto destination = start_position + (direction * (capture_distance + 1));
+
+                if (destination) {
+                    r[index.index][dir_i][capture_i].first = brd_item_t(capture);
+
+                    int jump_i = 0;
+                    while (destination) {
+                        r[index.index][dir_i][capture_i].second[jump_i++] = brd_index_t(destination);
+                        destination += direction;
+                    }
+
+                    capture_i++;
+                }
+            }
+        }
+    }
+
+    return r;
+}
+
+const struct
+{
+    std::array<std::array<std::array<brd_item_t, 7>, 4>, 32> king_moves = gen_king_moves();
+
+    // item index -> 4 directions -> list of pairs (capture mask, list of possible jump destination indexes)
+    std::array<std::array<std::array<std::pair<brd_item_t, std::array<brd_index_t, 6>>, 6>, 4>, 32>
+    king_captures = gen_king_captures();
+} walk_tables;
+
+
+// Kings moves and captures by walking king_moves/king_captures tables square by square
+// until the first blocker, the way generator worked before ray masks,
+// and capture sequences followed by iterative explorer, see capture_explorer.
+struct table_walk_generator : capture_explorer<>
+{
+    using capture_explorer<>::capture_explorer;
+
+    size_t walk_king_captures(const board_state_t& state, brd_index_t item_pos)
+    {
+        brd_map_t cur_occupied = state.occupied();
+        brd_map_t may_be_captured = state.sides[1].items;
+
+        chain_src = item_pos;
+        size_t saved_states = 0;
+        for (const auto& dir_captures : walk_tables.king_captures[item_pos.index]) {
+            for (const auto& dir_capture : dir_captures) {
+                brd_item_t capture_item = dir_capture.first;
+                if (!capture_item || state.sides[0].items.exist(capture_item)) {
+                    break;
+                }
+                if (may_be_captured.exist(capture_item)) {
+                    for (brd_index_t dst_index : dir_capture.second) {
+                        if (!dst_index || cur_occupied.exist(brd_item_t(dst_index))) {
+                            break;
+                        }
+                        board_state_t next_state = do_move(state, brd_item_t(item_pos), brd_item_t(dst_index));
+                        saved_states += next_captures<item_policy>(next_state, dst_index, brd_map_t(capture_item));
+                    }
+                    break;
+                }
+            }
+        }
+
+        return saved_states;
+    }
+
+    void walk_king_moves(brd_index_t item_pos)
+    {
+        for (const auto& move_dir : walk_tables.king_moves[item_pos.index]) {
+            for (brd_item_t dst : move_dir) {
+                if (!dst || occupied.exist(dst)) {
+                    break;
+                }
+                _states->push_back(do_move(cur_state, brd_item_t(item_pos), dst));
+                generated++;
+            }
+        }
+    }
+
+    // boards must contain kings only
+    size_t gen_kings_next_states(const board_state_t& brd)
+    {
+        prepare(brd);
+
+        for (brd_index_t pos : cur_state.sides[0].kings) {
+            walk_king_captures(cur_state, pos);
+        }
+        if (generated) {
+            return generated;
+        }
+
+        for (brd_index_t pos : cur_state.sides[0].kings) {
+            walk_king_moves(pos);
+        }
+        return generated;
+    }
+
+    // all completed capture sequences, including ones leading to duplicate states
+    size_t count_capture_sequences(const board_state_t& brd)
+    {
+        prepare(brd);
+
+        size_t sequences = 0;
+        for (brd_index_t pos : cur_state.sides[0].items) {
+            chain_src = pos;
+            if (cur_state.sides[0].kings.exist(brd_item_t(pos))) {
+                sequences += next_captures<king_policy>(cur_state, pos, {});
+            } else {
+                sequences += next_captures<item_policy>(cur_state, pos, {});
+            }
+        }
+        return sequences;
+    }
+};
+
+
+// square-by-square scan over whole board, the way generator worked before bit-scan iteration
+size_t gen_next_states_scan(table_walk_generator& g, const board_state_t& brd)
+{
+    g.prepare(brd);
+
+    for (brd_index_t pos = 0; pos; ++pos) {
+        g.gen_item_captures(pos);
+    }
+    if (g.generated) {
+        return g.generated;
+    }
+
+    for (brd_index_t pos = 0; pos; ++pos) {
+        g.gen_item_moves(pos);
+    }
+    return g.generated;
+}
+
+
+template<typename F>
+size_t bench(const char* name, const std::vector<board_state_t>& boards, size_t rounds, F&& gen)
+{
+    std::vector<board_state_t> states;
+    states.reserve(MAX_LEVEL_WIDTH);
+    table_walk_generator g(states);
+
+    size_t total = 0;
+    auto started = BenchClock::now();
+
+    for (size_t r = 0; r < rounds; r++) {
+        for (const auto& brd : boards) {
+            states.clear();
+            total += gen(g, brd);
+        }
+    }
+
+    float elapsed_s = total_seconds(BenchClock::now() - started);
+    size_t n = boards.size() * rounds;
+
+    printf("  %-24s %8.2f ns/board, %8.2f Mboards/s generated (%lu)\n",
+           name, elapsed_s * 1e9 / n, total / elapsed_s / 1000000, total);
+
+    return total;
+}
+
+void bench_generator(const char* title, const std::vector<board_state_t>& boards, size_t rounds)
+{
+    printf("%s, %lu boards x %lu rounds:\n", title, boards.size(), rounds);
+
+    size_t before = bench("square scan", boards, rounds, gen_next_states_scan);
+    size_t after = bench("gen_next_states", boards, rounds, [] (table_walk_generator& g, const board_state_t& brd) {
+        return g.gen_next_states(brd);
+    });
+
+    if (before != after) {
+        report_mismatch("generated boards");
+    }
+    printf("\n");
+}
+
+
+void bench_sparse()
+{
+    bench_generator("endgame, 1-3 items per side", gen_boards(100000, 1, 3, 0.3), 20);
+    bench_generator("middlegame, 5-8 items per side", gen_boards(100000, 5, 8, 0.1), 10);
+}
+
+
+void bench_kings()
+{
+    for (int n : {2, 4, 8}) {
+        auto boards = gen_boards(100000, n, n, 1.0);
+        printf("kings only, %d kings per side, %lu boards x %d rounds:\n", n, boards.size(), 10);
+
+        size_t before = bench("table walk", boards, 10, [] (table_walk_generator& g, const board_state_t& brd) {
+            return g.gen_kings_next_states(brd);
+        });
+        size_t after = bench("ray masks", boards, 10, [] (table_walk_generator& g, const board_state_t& brd) {
+            return g.gen_next_states(brd);
+        });
+
+        if (before != after) {
+            report_mismatch("generated boards");
+        }
+        printf("\n");
+    }
+}
+
+
+// BFS frontier from initial board, absolute orientation, 'depth' moves done
+std::vector<board_state_t> gen_frontier(size_t depth)
+{
+    std::vector<board_state_t> level{initial_board};
+    for (size_t d = 0; d < depth; d++) {
+        std::vector<board_state_t> next;
+        _board_states_generator<0> white(next);
+        _board_states_generator<1> black(next);
+        for (const auto& brd : level) {
+            if (d % 2 == 0) {
+                white.gen_next_states(brd);
+            } else {
+                black.gen_next_states(brd);
+            }
+        }
+        level = std::move(next);
+    }
+    return level;
+}
+
+template<size_t side_i>
+void bench_batch_level(const char* title, const std::vector<board_state_t>& boards, size_t rounds)
+{
+    printf("%s, %lu boards x %lu rounds:\n", title, boards.size(), rounds);
+
+    std::vector<board_state_t> single, batch;
+    single.reserve(boards.size() * 8);
+    batch.reserve(boards.size() * 8);
+    _board_states_generator<side_i> gs(single), gb(batch);
+
+    auto started = BenchClock::now();
+    for (size_t r = 0; r < rounds; r++) {
+        single.clear();
+        for (const auto& brd : boards) {
+            gs.gen_next_states(brd);
+        }
+    }
+    float single_s = total_seconds(BenchClock::now() - started);
+
+    boards_soa_t soa(boards);
+    started = BenchClock::now();
+    for (size_t r = 0; r < rounds; r++) {
+        batch.clear();
+        gen_next_states_batch(gb, soa, [] (size_t) {});
+    }
+    float batch_s = total_seconds(BenchClock::now() - started);
+
+    size_t n = boards.size() * rounds;
+    printf("  %-24s %8.2f ns/board\n", "per board", single_s * 1e9 / n);
+    printf("  %-24s %8.2f ns/board%s\n", "batch of 8", batch_s * 1e9 / n, single == batch ? "" : " ERROR: generated boards mismatch");
+    failed |= single != batch;
+    printf("\n");
+}
+
+void bench_batch()
+{
+    // even depth - white to move
+    bench_batch_level<0>("BFS frontier at depth 8", gen_frontier(8), 3);
+    bench_batch_level<0>("middlegame, 5-8 items per side", gen_boards(1000000, 5, 8, 0.1), 3);
+    bench_batch_level<0>("endgame, 1-3 items per side", gen_boards(1000000, 1, 3, 0.3), 3);
+}
+
+
+// Bit reverse with per-byte table, the way reverse() worked before bit tricks.
+// https://stackoverflow.com/questions/746171/efficient-algorithm-for-bit-reversal-from-msb-lsb-to-lsb-msb-in-c
+inline constexpr uint8_t bit_reverse_table_256[] = 
+{
+    0x00, 0x80, 0x40, 0xC0, 0x20, 0xA0, 0x60, 0xE0, 0x10, 0x90, 0x50, 0xD0, 0x30, 0xB0, 0x70, 0xF0, 
+    0x08, 0x88, 0x48, 0xC8, 0x28, 0xA8, 0x68, 0xE8, 0x18, 0x98, 0x58, 0xD8, 0x38, 0xB8, 0x78, 0xF8, 
+    0x04, 0x84, 0x44, 0xC4, 0x24, 0xA4, 0x64, 0xE4, 0x14, 0x94, 0x54, 0xD4, 0x34, 0xB4, 0x74, 0xF4, 
+    0x0C, 0x8C, 0x4C, 0xCC, 0x2C, 0xAC, 0x6C, 0xEC, 0x1C, 0x9C, 0x5C, 0xDC, 0x3C, 0xBC, 0x7C, 0xFC, 
+    0x02, 0x82, 0x42, 0xC2, 0x22, 0xA2, 0x62, 0xE2, 0x12, 0x92, 0x52, 0xD2, 0x32, 0xB2, 0x72, 0xF2, 
+    0x0A, 0x8A, 0x4A, 0xCA, 0x2A, 0xAA, 0x6A, 0xEA, 0x1A, 0x9A, 0x5A, 0xDA, 0x3A, 0xBA, 0x7A, 0xFA,
+    0x06, 0x86, 0x46, 0xC6, 0x26, 0xA6, 0x66, 0xE6, 0x16, 0x96, 0x56, 0xD6, 0x36, 0xB6, 0x76, 0xF6, 
+    0x0E, 0x8E, 0x4E, 0xCE, 0x2E, 0xAE, 0x6E, 0xEE, 0x1E, 0x9E, 0x5E, 0xDE, 0x3E, 0xBE, 0x7E, 0xFE,
+    0x01, 0x81, 0x41, 0xC1, 0x21, 0xA1, 0x61, 0xE1, 0x11, 0x91, 0x51, 0xD1, 0x31, 0xB1, 0x71, 0xF1,
+    0x09, 0x89, 0x49, 0xC9, 0x29, 0xA9, 0x69, 0xE9, 0x19, 0x99, 0x59, 0xD9, 0x39, 0xB9, 0x79, 0xF9, 
+    0x05, 0x85, 0x45, 0xC5, 0x25, 0xA5, 0x65, 0xE5, 0x15, 0x95, 0x55, 0xD5, 0x35, 0xB5, 0x75, 0xF5,
+    0x0D, 0x8D, 0x4D, 0xCD, 0x2D, 0xAD, 0x6D, 0xED, 0x1D, 0x9D, 0x5D, 0xDD, 0x3D, 0xBD, 0x7D, 0xFD,
+    0x03, 0x83, 0x43, 0xC3, 0x23, 0xA3, 0x63, 0xE3, 0x13, 0x93, 0x53, 0xD3, 0x33, 0xB3, 0x73, 0xF3, 
+    0x0B, 0x8B, 0x4B, 0xCB, 0x2B, 0xAB, 0x6B, 0xEB, 0x1B, 0x9B, 0x5B, 0xDB, 0x3B, 0xBB, 0x7B, 0xFB,
+    0x07, 0x87, 0x47, 0xC7, 0x27, 0xA7, 0x67, 0xE7, 0x17, 0x97, 0x57, 0xD7, 0x37, 0xB7, 0x77, 0xF7, 
+    0x0F, 0x8F, 0x4F, 0xCF, 0x2F, 0xAF, 0x6F, 0xEF, 0x1F, 0x9F, 0x5F, 0xDF, 0x3F, 0xBF, 0x7F, 0xFF
+};
+
+brd_map_t table_reverse(const brd_map_t& m)
+{
+    return (uint32_t(bit_reverse_table_256[m.mask & 0xff]) << 24) |
+           (uint32_t(bit_reverse_table_256[(m.mask >> 8) & 0xff]) << 16) |
+           (uint32_t(bit_reverse_table_256[(m.mask >> 16) & 0xff]) << 8) |
+           (uint32_t(bit_reverse_table_256[(m.mask >> 24) & 0xff]));
+}
+
+board_state_t table_rotate(const board_state_t& s)
+{
+    return {
+        board_side_t{table_reverse(s.sides[1].kings), table_reverse(s.sides[1].items)},
+        board_side_t{table_reverse(s.sides[0].kings), table_reverse(s.sides[0].items)}
+    };
+}
+
+#if defined(__SSSE3__)
+// Board is 16 bytes - single SSE register. One byte shuffle swaps sides and reverses
+// order of bytes in every mask, then bits inside bytes are reversed with two 4-bit lookup shuffles.
+
+inline __m128i rotate_16(__m128i x)
+{
+    const __m128i swap_bytes = _mm_setr_epi8(11, 10, 9, 8, 15, 14, 13, 12, 3, 2, 1, 0, 7, 6, 5, 4);
+    // reversed nibble, for low and for high nibble of byte
+    const __m128i rev_lo = _mm_setr_epi8(0x00, 0x80, 0x40, 0xC0, 0x20, 0xA0, 0x60, 0xE0, 0x10, 0x90, 0x50, 0xD0, 0x30, 0xB0, 0x70, 0xF0);
+    const __m128i rev_hi = _mm_setr_epi8(0x0, 0x8, 0x4, 0xC, 0x2, 0xA, 0x6, 0xE, 0x1, 0x9, 0x5, 0xD, 0x3, 0xB, 0x7, 0xF);
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+
+    x = _mm_shuffle_epi8(x, swap_bytes);
+    __m128i lo = _mm_and_si128(x, nibble);
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(x, 4), nibble);
+    return _mm_or_si128(_mm_shuffle_epi8(rev_lo, lo), _mm_shuffle_epi8(rev_hi, hi));
+}
+#endif
+
+#if defined(__AVX2__)
+// same as rotate_16(), two boards per step
+inline __m256i rotate_32(__m256i x)
+{
+    const __m256i swap_bytes = _mm256_setr_epi8(11, 10, 9, 8, 15, 14, 13, 12, 3, 2, 1, 0, 7, 6, 5, 4,
+                                                11, 10, 9, 8, 15, 14, 13, 12, 3, 2, 1, 0, 7, 6, 5, 4);
+    const __m256i rev_lo = _mm256_setr_epi8(0x00, 0x80, 0x40, 0xC0, 0x20, 0xA0, 0x60, 0xE0, 0x10, 0x90, 0x50, 0xD0, 0x30, 0xB0, 0x70, 0xF0,
+                                            0x00, 0x80, 0x40, 0xC0, 0x20, 0xA0, 0x60, 0xE0, 0x10, 0x90, 0x50, 0xD0, 0x30, 0xB0, 0x70, 0xF0);
+    const __m256i rev_hi = _mm256_setr_epi8(0x0, 0x8, 0x4, 0xC, 0x2, 0xA, 0x6, 0xE, 0x1, 0x9, 0x5, 0xD, 0x3, 0xB, 0x7, 0xF,
+                                            0x0, 0x8, 0x4, 0xC, 0x2, 0xA, 0x6, 0xE, 0x1, 0x9, 0x5, 0xD, 0x3, 0xB, 0x7, 0xF);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+
+    x = _mm256_shuffle_epi8(x, swap_bytes);
+    __m256i lo = _mm256_and_si256(x, nibble);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble);
+    return _mm256_or_si256(_mm256_shuffle_epi8(rev_lo, lo), _mm256_shuffle_epi8(rev_hi, hi));
+}
+#endif
+
+// Rotate array of boards in place.
+// SIMD kernel is selected at compile time (-mssse3, -mavx2), scalar rotate() is fallback and tail.
+// Search doesn't rotate boards since generators are instantiated per side, so it's kept only here for comparison.
+void rotate(board_state_t* boards, size_t n)
+{
+    size_t i = 0;
+#if defined(__AVX2__)
+    for (; i + 2 <= n; i += 2) {
+        auto p = reinterpret_cast<__m256i*>(boards + i);
+        _mm256_storeu_si256(p, rotate_32(_mm256_loadu_si256(p)));
+    }
+#elif defined(__SSSE3__)
+    for (; i < n; i++) {
+        auto p = reinterpret_cast<__m128i*>(boards + i);
+        _mm_storeu_si128(p, rotate_16(_mm_loadu_si128(p)));
+    }
+#endif
+    for (; i < n; i++) {
+        boards[i] = rotate(boards[i]);
+    }
+}
+
+void rotate(std::vector<board_state_t>& boards)
+{
+    rotate(boards.data(), boards.size());
+}
+
+
+template<typename F>
+void bench_rotate(const char* name, std::vector<board_state_t> boards, size_t rounds, const std::vector<board_state_t>& expected, F&& rotate_level)
+{
+    auto started = BenchClock::now();
+
+    for (size_t r = 0; r < rounds; r++) {
+        rotate_level(boards);
+    }
+
+    float elapsed_s = total_seconds(BenchClock::now() - started);
+    size_t n = boards.size() * rounds;
+
+    printf("  %-24s %8.2f ns/board, %8.2f Mboards/s%s\n",
+           name, elapsed_s * 1e9 / n, n / elapsed_s / 1000000, boards == expected ? "" : " ERROR: result mismatch");
+    failed |= boards != expected;
+}
+
+void bench_rotation()
+{
+    auto boards = gen_boards(1000000, 1, 12, 0.2);
+    size_t rounds = 21;
+
+    std::vector<board_state_t> expected = boards;
+    for (auto& b : expected) {
+        b = table_rotate(b);
+    }
+
+#if defined(__AVX2__)
+    const char* simd = "AVX2";
+#elif defined(__SSSE3__)
+    const char* simd = "SSSE3";
+#else
+    const char* simd = "scalar";
+#endif
+    printf("rotation, %lu boards x %lu rounds:\n", boards.size(), rounds);
+
+    bench_rotate("byte table", boards, rounds, expected, [] (std::vector<board_state_t>& v) {
+        for (auto& b : v) {
+            b = table_rotate(b);
+        }
+    });
+    bench_rotate("bit tricks", boards, rounds, expected, [] (std::vector<board_state_t>& v) {
+        for (auto& b : v) {
+            b = rotate(b);
+        }
+    });
+    bench_rotate(simd, boards, rounds, expected, [] (std::vector<board_state_t>& v) {
+        rotate(v);
+    });
+    printf("\n");
+}
+
+
+// Capture results deduplication used to be bit filter (bitwise OR of saved states)
+// plus linear scan of saved states when filter says 'maybe'.
+// Count how often the scan was done for distinct state - filter false positives.
+void bench_dedup()
+{
+    for (int n : {4, 8, 12}) {
+        auto boards = gen_boards(200000, n, n, 0.5);
+
+        std::vector<board_state_t> states;
+        table_walk_generator g(states);
+
+        size_t positions = 0, sequences = 0, distinct = 0, false_positives = 0;
+        for (const auto& brd : boards) {
+            if (!can_capture(brd)) {
+                continue;
+            }
+            states.clear();
+            positions++;
+            sequences += g.count_capture_sequences(brd);
+            distinct += states.size();
+
+            board_state_t filter{};
+            for (const auto& s : states) {
+                if (filter.contains(s)) {
+                    false_positives++;
+                }
+                filter.bit_add(s);
+            }
+        }
+
+        printf("%2d items per side, half kings: %lu positions with captures\n", n, positions);
+        printf("  capture sequences: %lu, distinct results: %lu, duplicates: %lu\n",
+               sequences, distinct, sequences - distinct);
+        printf("  bit filter false positives: %lu (%.2f%% of distinct results)\n",
+               false_positives, distinct ? 100.0 * false_positives / distinct : 0.0);
+
+        bench("gen_next_states", boards, 10, [] (table_walk_generator& g, const board_state_t& brd) {
+            return g.gen_next_states(brd);
+        });
+        printf("\n");
+    }
+}
+
+
+// Recursive capture kernels vs iterative explorer with explicit stack, positions with captures only.
+void bench_chains()
+{
+    for (auto [n, king_p] : {std::pair{4, 0.5}, std::pair{8, 0.2}, std::pair{12, 0.1}, std::pair{8, 1.0}}) {
+        std::vector<board_state_t> boards;
+        size_t mismatches = 0;
+        for (const auto& brd : gen_boards(300000, n, n, king_p)) {
+            if (can_capture(brd)) {
+                boards.push_back(brd);
+                mismatches += sorted_captures<0>(brd, true) != sorted_captures<0>(brd, false);
+            }
+        }
+        printf("%d items per side, kings %.0f%%, %lu boards with captures x %d rounds:\n", n, king_p * 100, boards.size(), 10);
+
+        size_t before = bench("recursive kernels", boards, 10, [] (table_walk_generator& g, const board_state_t& brd) {
+            g.prepare(brd);
+            return g.gen_captures();
+        });
+        size_t after = bench("iterative explorer", boards, 10, [] (table_walk_generator& g, const board_state_t& brd) {
+            g.prepare(brd);
+            return g.gen_captures_iterative();
+        });
+
+        if (before != after || mismatches > 0) {
+            report_mismatch("generated boards");
+        }
+        printf("\n");
+    }
+}
+
+
+// Single-thread DFS vs worker of MTDFS constructed the same way as MTDFS does,
+// worker must not lose bulk leaves counting, so the rates must be the same.
+template<class F>
+size_t bench_dfs(const char* name, size_t rounds, F&& search)
+{
+    size_t total = 0;
+    auto started = BenchClock::now();
+
+    for (size_t r = 0; r < rounds; r++) {
+        total += std::get<0>(search()).total_boards();
+    }
+
+    float elapsed_s = total_seconds(BenchClock::now() - started);
+    printf("  %-24s %8.2f Mboards/s (%lu)\n", name, total / elapsed_s / 1000000, total / rounds);
+
+    return total;
+}
+
+void bench_search()
+{
+    for (size_t depth : {9, 11}) {
+        search_config_t cfg{depth, Clock::now() + 1h};
+        printf("DFS, depth %lu:\n", depth);
+
+        size_t before = bench_dfs("single thread", 3, [&cfg] () {
+            DFS<judy_cache> x(cfg, false);
+            return x._do_search(initial_board);
+        });
+        size_t after = bench_dfs("MTDFS worker", 3, [&cfg] () {
+            DFS<judy_cache, false> x(cfg);
+            return x.do_search({initial_board}, 0);
+        });
+
+        if (before != after) {
+            report_mismatch("total boards");
+        }
+        printf("\n");
+    }
+}
+
+
+int main(int argc, const char* argv[])
+{
+    // optional argument - name of single benchmark to run
+    auto enabled = [argc, argv] (const char* name) {
+        return argc < 2 || strcmp(argv[1], name) == 0;
+    };
+
+    if (enabled("sparse")) {
+        bench_sparse();
+    }
+    if (enabled("kings")) {
+        bench_kings();
+    }
+    if (enabled("dedup")) {
+        bench_dedup();
+    }
+    if (enabled("rotation")) {
+        bench_rotation();
+    }
+    if (enabled("batch")) {
+        bench_batch();
+    }
+    if (enabled("chains")) {
+        bench_chains();
+    }
+    if (enabled("search")) {
+        bench_search();
+    }
+
+    return failed ? 1 : 0;
+}
@@ -67,10 +67,10 @@ void debug_depth(board_state_t brd, size_t depth)
             printf("\n  move: %lu\n", cnt);
             print(brd);
 
-            v = g.gen_next_states(rotate(brd));
+            v = g.gen_next_states<1>(brd);
             cnt++;
             if (v.size() > 0) {
-                brd = rotate(v.front());
+                brd = v.front();
             } else {
                 break;
             }
@@ -106,80 +106,32 @@ void debug()
         }
     }
 
-    printf("fwd_moves:\n");
+    printf("fwd_dst_masks:\n");
     for (int i = 0; i < 32; i++) {
-        printf("%2d %08x -> ", i, 1 << i);
-        const auto& a = tables.fwd_destinations[i];
-        size_t j = 0;
-        for (auto v = a[j]; v && j < a.size(); v = a[++j]) {
-            printf("%08x, ", v.mask);
-        }
-        printf("\n");
+        brd_map_t item = 1 << i;
+        printf("%2d %08x -> %08x\n", i, 1 << i, (step<0>(item) + step<1>(item)).mask);
     }
-    printf("captures:\n");
+    printf("capture_masks:\n");
     for (int i = 0; i < 32; i++) {
-        printf("%2d %08x -> ", i, 1 << i);
-        const auto& a = tables.captures[i];
-        size_t j = 0;
-        for (auto v = a[j]; std::get<0>(v) && j < a.size(); v = a[++j]) {
-            printf("%08x_%d, ", std::get<0>(v).mask, std::get<1>(v).index);
-        }
-        printf("\n");
+        brd_map_t item = 1 << i;
+        printf("%2d %08x -> %08x\n", i, 1 << i, (step<0>(item) + step<1>(item) + step<2>(item) + step<3>(item)).mask);
     }
-    printf("king_moves:\n");
+    printf("capture_move_masks:\n");
     for (int i = 0; i < 32; i++) {
-        printf("%2d %08x -> ", i, 1 << i);
-        const auto& a = tables.king_moves[i];
-        for (const auto& b : a) {
-            size_t j = 0;
-            printf("[");
-            for (auto v = b[j]; v && j < b.size(); v = b[++j]) {
-                printf("%s%08x", j == 0 ? "" : ", ", v.mask);
-            }
-            printf("], ");
-        }
-        printf("\n");
+        brd_map_t item = 1 << i;
+        brd_map_t all = 0xFFFFFFFF;
+        printf("%2d %08x -> %08x\n", i, 1 << i,
+               (jump<0>(item, all, all) + jump<1>(item, all, all) + jump<2>(item, all, all) + jump<3>(item, all, all)).mask);
     }
-    printf("king_captures:\n");
+    printf("king_rays:\n");
     for (int i = 0; i < 32; i++) {
         printf("%2d %08x -> ", i, 1 << i);
-        const auto& a = tables.king_captures[i];
-        for (const auto& b : a) {
-            size_t j = 0;
-            printf("[");
-            for (auto v = b[j]; v.first && j < b.size(); v = b[++j]) {
-                printf("%s{%08x, [", j == 0 ? "" : ", ", v.first.mask);
-                int k = 0;
-                for (auto dst : v.second) {
-                    if (!dst) {
-                        break;
-                    }
-                    printf("%s%d", k++ == 0 ? "" : ", ", dst.index);
-                }
-                printf("]}");
-            }
-            printf("], ");
+        for (const auto& ray : tables.king_rays[i]) {
+            printf("%08x, ", ray.mask);
         }
         printf("\n");
     }
 
-    printf("fwd_move_masks:\n");
-    for (int i = 0; i < 32; i++) {
-        printf("%2d %08x -> %08x\n", i, 1 << i, tables.fwd_dst_masks[i].mask);
-    }
-    printf("capture_move_masks:\n");
-    for (int i = 0; i < 32; i++) {
-        printf("%2d %08x -> %08x\n", i, 1 << i, tables.capture_move_masks[i].mask);
-    }
-    printf("capture_masks:\n");
-    for (int i = 0; i < 32; i++) {
-        printf("%2d %08x -> %08x\n", i, 1 << i, tables.capture_masks[i].mask);
-    }
-    printf("king_move_masks:\n");
-    for (int i = 0; i < 32; i++) {
-        printf("%2d %08x -> %08x\n", i, 1 << i, tables.king_move_masks[i].mask);
-    }
-
 
     for (brd_index_t index = 0; index; ++index) {
         auto x = brd_2d_vector_t(index);
@@ -0,0 +1,139 @@
+#include <memory>
+
+#include "dts_search.h"
+#include "dfs.h"
+#include "mtdfs.h"
+#include "perft.h"
+
+
+// Compiled once per instruction set variant with ENGINE_ISA defined (see src/meson.build),
+// generation, rotation, hashing and batch expansion are all inlined into search of the variant.
+
+ENGINE_NAMESPACE_BEGIN
+
+// options which define search state, the others are taken from command line on resume
+void save_options(checkpoint_writer& w, const dts_options_t& opts)
+{
+    w.put_string(opts.command);
+    w.put_string(opts.cache_impl);
+    w.put(opts.max_depth);
+    w.put(opts.max_width);
+    w.put(opts.randomize);
+    w.put(opts.cache);
+    w.put(opts.chain_cache);
+    w.put(opts.cache_mb);
+    w.put(opts.n_threads);
+    w.put(opts.checkpoint_cache);
+}
+
+void load_options(checkpoint_reader& r, dts_options_t& opts)
+{
+    opts.command = r.get_string();
+    opts.cache_impl = r.get_string();
+    opts.max_depth = r.get<size_t>();
+    opts.max_width = r.get<size_t>();
+    opts.randomize = r.get<bool>();
+    opts.cache = r.get<bool>();
+    opts.chain_cache = r.get<bool>();
+    opts.cache_mb = r.get<size_t>();
+    opts.n_threads = r.get<size_t>();
+    opts.checkpoint_cache = r.get<bool>();
+    // only iterative search is saved
+    opts.lazy = false;
+    opts.in_place = false;
+    opts.iterative = true;
+}
+
+template<class Search>
+void run_search(Search& x, const dts_options_t& opts, checkpoint_reader* resume)
+{
+    auto write = [&x, &opts] () {
+        checkpoint_writer w(opts.checkpoint);
+        save_options(w, opts);
+        x.save(w);
+        w.commit();
+    };
+
+    if (!opts.checkpoint.empty()) {
+        x.set_checkpoint(write, opts.checkpoint_period);
+    }
+
+    if (resume) {
+        x.load(*resume);
+        x.resume();
+    } else {
+        x.do_search(initial_board);
+    }
+
+    if (!opts.checkpoint.empty()) {
+        write();
+        printf("\nCheckpoint: %s\n", opts.checkpoint.c_str());
+    }
+}
+
+template<class Cache>
+void run_cache(const dts_options_t& opts, const search_config_t& scfg, checkpoint_reader* resume)
+{
+    if (opts.command == "dfs") {
+        DFS<Cache> x(scfg, opts.verbose, opts.print_wins, opts.print_cache_hits);
+        run_search(x, opts, resume);
+    } else {
+        MTDFS<DFS<Cache, false>> x(opts.n_threads, scfg);
+        run_search(x, opts, resume);
+    }
+}
+
+void run(const dts_options_t& cmdline_opts)
+{
+    dts_options_t opts = cmdline_opts;
+    std::unique_ptr<checkpoint_reader> resume;
+    if (!opts.resume.empty()) {
+        resume = std::make_unique<checkpoint_reader>(opts.resume);
+        load_options(*resume, opts);
+    }
+
+    if (opts.command == "perft") {
+        PERFT x(opts.max_depth, opts.run_until, opts.cache_mb << 20);
+        x.do_search(initial_board);
+        return;
+    }
+
+    search_config_t scfg{
+        opts.max_depth,
+        opts.run_until,
+        opts.max_width,
+        opts.randomize,
+        opts.cache,
+        opts.lazy,
+        opts.chain_cache,
+        opts.in_place,
+        opts.iterative,
+        opts.cache_mb,
+        opts.checkpoint_cache
+    };
+
+    if (opts.cache_impl == "std") {
+        run_cache<std_cache>(opts, scfg, resume.get());
+    } else if (opts.cache_impl == "dense") {
+        run_cache<dense_cache>(opts, scfg, resume.get());
+    } else if (opts.cache_impl == "bucket") {
+        run_cache<bounded_cache>(opts, scfg, resume.get());
+    } else {
+        run_cache<judy_cache>(opts, scfg, resume.get());
+    }
+}
+
+void stop()
+{
+    g_running = false;
+}
+
+ENGINE_NAMESPACE_END
+
+
+// the only symbol exported from library of variant, see src/meson.build
+extern const dts_variant_t ENGINE_ISA_CONCAT(dts_variant_, ENGINE_ISA) __attribute__((visibility("default"))) = {
+    ENGINE_ISA_STR(ENGINE_ISA),
+    &run,
+    &stop
+};
@@ -5,19 +5,41 @@
 #include <boost/program_options.hpp>
 
 #include "utils.h"
-#include "draughts.h"
-#include "dfs.h"
-#include "mtdfs.h"
+#include "dts_search.h"
 
 using namespace std::string_literals;
 
 namespace po = boost::program_options;
 
+using Clock = std::chrono::system_clock;
 
+// far enough, but run_until is still printable
+constexpr Clock::duration unlimited = 24h * 365 * 100;
+
+
+// search variants from the least to the most capable, and if CPU supports each of them
+std::vector<std::pair<const dts_variant_t*, bool>> isa_variants()
+{
+    std::vector<std::pair<const dts_variant_t*, bool>> r{{&dts_variant_scalar, true}};
+
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    bool bmi2 = __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt")
+             && __builtin_cpu_supports("bmi") && __builtin_cpu_supports("bmi2");
+    r.push_back({&dts_variant_bmi2, bmi2});
+    r.push_back({&dts_variant_avx2, bmi2 && __builtin_cpu_supports("avx2")});
+#endif
+
+    return r;
+}
+
+const dts_variant_t* g_variant = nullptr;
 
 void signal_handler(int signum)
 {
-   g_running = false;
+    if (g_variant) {
+        g_variant->stop();
+    }
 }
 
 int main(int argc, const char* argv[])
@@ -30,23 +52,37 @@ int main(int argc, const char* argv[])
     readable_duration_t<Clock> timeout{10s};
     std::string command;
     bool randomize;
+    bool lazy;
+    bool chain_cache;
+    bool in_place;
+    bool iterative;
     size_t max_width;
     bool cache;
     bool print_cache_hits;
     bool print_wins;
     std::string cache_impl;
+    size_t cache_mb;
     size_t n_threads;
+    std::string isa;
+    std::string checkpoint;
+    readable_duration_t<Clock> checkpoint_period{10min};
+    bool checkpoint_cache;
+    std::string resume;
 
     std::string header = "DTS - Decision Tree Statistics (Russian Draughts)\n";
     header += "\nUsage: ";
     header += argv[0];
-    header += " dfs|mtdfs [options]\n";
+    header += " dfs|mtdfs|perft [options]\n";
+    header += "       ";
+    header += argv[0];
+    header += " --resume <file> [options]\n";
     header += "\nCommands:\n";
     header += "  dfs - Depth-first search\n";
     header += "  mtdfs - Multi-threaded depth-first search\n";
+    header += "  perft - Count full tree up to max depth, subtrees are memoized by board and remaining depth\n";
     header += "\nOptions";
 
-    std::string timeout_desc = "timeout, default=10s\nunits = "s + readable_duration_t<Clock>::all_units("|") + "\ndefault unit = s";
+    std::string timeout_desc = "timeout, default=10s, with --resume - unlimited\nunits = "s + readable_duration_t<Clock>::all_units("|") + "\ndefault unit = s";
 
     po::options_description visible_opts(header);
     visible_opts.add_options()
@@ -56,11 +92,21 @@ int main(int argc, const char* argv[])
         ("timeout,t", po::value<decltype(timeout)>(&timeout), timeout_desc.c_str())
         ("randomize,r", po::bool_switch(&randomize), "randomize braches iteration")
         ("max-width,w", po::value<size_t>(&max_width)->default_value(0), "max branches iterate, 0 - all\nwith randomize=false max-width = 1|2|3")
+        ("lazy,l", po::bool_switch(&lazy), "generate successors one at a time,\nwith max-width only first max-width are generated")
+        ("in-place,i", po::bool_switch(&in_place), "single board, moves are applied and reverted in place")
+        ("iterative,I", po::bool_switch(&iterative), "explicit stack of frames instead of recursion")
+        ("chain-cache", po::bool_switch(&chain_cache), "memoize capture sequences of pieces by their surroundings")
         ("cache,c", po::bool_switch(&cache), "enable board cache and cache_hit detection")
         ("print-cache-hits,H", po::bool_switch(&print_cache_hits), "print board for cache hit case")
         ("print-wins,W", po::bool_switch(&print_wins), "print entire path for win case")
-        ("cache-impl,C", po::value<std::string>(&cache_impl)->default_value("judy"), "cache implementation: std|dense|judy")
+        ("cache-impl,C", po::value<std::string>(&cache_impl)->default_value("judy"), "cache implementation: std|dense|judy|bucket,\nbucket - fixed-size table, others grow without limit")
+        ("cache-mb", po::value<size_t>(&cache_mb)->default_value(256), "size of bucket cache table per thread, MiB,\nfor perft - size of memo table, 0 - no memoization")
         ("threads,j", po::value<size_t>(&n_threads)->default_value(1), "number of threads, for mtdfs")
+        ("isa", po::value<std::string>(&isa), "instruction set variant of search: scalar|bmi2|avx2,\ndefault - the best supported by CPU")
+        ("checkpoint", po::value<std::string>(&checkpoint), "file of periodic and final checkpoints of search state,\nimplies iterative search")
+        ("checkpoint-period", po::value<decltype(checkpoint_period)>(&checkpoint_period), "period of checkpoints, default=10m")
+        ("checkpoint-cache", po::bool_switch(&checkpoint_cache), "save bucket cache into checkpoint")
+        ("resume", po::value<std::string>(&resume), "continue search from checkpoint file,\nsearch options are restored from it,\ncheckpoints are written into the same file by default,\nwithout --timeout search runs until completed")
     ;
 
     po::options_description hidden_opts;
@@ -90,64 +136,112 @@ int main(int argc, const char* argv[])
         return 0;
     }
 
-    search_config_t scfg{
-        max_depth,
-        Clock::now() + timeout.value,
-        max_width,
-        randomize,
-        cache
-    };
-
-    if (command == "dfs") {
-        if (cache_impl == "std") {
-
-            DFS<std_cache> x(scfg, verbose, print_wins, print_cache_hits);
-            x.do_search(initial_board);
-
-        } else if (cache_impl == "dense") {
-
-            DFS<dense_cache> x(scfg, verbose, print_wins, print_cache_hits);
-            x.do_search(initial_board);
-
-        } else if (cache_impl == "judy") {
-
-            DFS<judy_cache> x(scfg, verbose, print_wins, print_cache_hits);
-            x.do_search(initial_board);
-
+    if (!resume.empty()) {
+        // search options are restored from checkpoint
+        if (checkpoint.empty()) {
+            checkpoint = resume;
+        }
+        // resumed search is usually a long one, it's stopped by signal if needed
+        if (vm.count("timeout") == 0) {
+            timeout = unlimited;
+        }
+    } else if (command != "dfs" && command != "mtdfs" && command != "perft") {
+        if (vm.count("command") == 0) {
+            std::cerr << "command is required" << std::endl;
         } else {
-            std::cerr << "unknown cache implementation: \"" << cache_impl << "\"" << std::endl;
-            std::cerr << visible_opts << std::endl;
+            std::cerr << "Unknown command" << std::endl;
         }
+        std::cerr << visible_opts << std::endl;
+        return 1;
+    }
 
-    } else if (command == "mtdfs") {
+    if (cache_impl != "std" && cache_impl != "dense" && cache_impl != "judy" && cache_impl != "bucket") {
+        std::cerr << "unknown cache implementation: \"" << cache_impl << "\"" << std::endl;
+        std::cerr << visible_opts << std::endl;
+        return 1;
+    }
 
-        if (cache_impl == "std") {
+    if (lazy && randomize) {
+        std::cerr << "randomize is not applicable to lazy generation" << std::endl;
+        return 1;
+    }
 
-            MTDFS<DFS<std_cache, false>> x(n_threads, scfg);
-            x.do_search(initial_board);
+    if (cache_impl == "bucket" && max_depth > UINT16_MAX) {
+        std::cerr << "max depth of bucket cache is " << UINT16_MAX << std::endl;
+        return 1;
+    }
 
-        } else if (cache_impl == "dense") {
+    if (lazy && in_place) {
+        std::cerr << "lazy generation is not implemented for in-place search" << std::endl;
+        return 1;
+    }
 
-            MTDFS<DFS<dense_cache, false>> x(n_threads, scfg);
-            x.do_search(initial_board);
+    if (iterative && (lazy || in_place)) {
+        std::cerr << "iterative search is not combined with lazy generation or in-place search" << std::endl;
+        return 1;
+    }
 
-        } else if (cache_impl == "judy") {
+    if (!checkpoint.empty()) {
+        if (command == "perft") {
+            std::cerr << "checkpoints are not implemented for perft" << std::endl;
+            return 1;
+        }
+        if (lazy || in_place) {
+            std::cerr << "checkpoints are not combined with lazy generation or in-place search" << std::endl;
+            return 1;
+        }
+        iterative = true;
+    }
 
-            MTDFS<DFS<judy_cache, false>> x(n_threads, scfg);
-            x.do_search(initial_board);
+    if (checkpoint_cache && cache_impl != "bucket") {
+        std::cerr << "only bucket cache can be saved into checkpoint" << std::endl;
+        return 1;
+    }
 
-        } else {
-            std::cerr << "unknown cache implementatin: \"" << cache_impl << "\"" << std::endl;
-            std::cerr << visible_opts << std::endl;
+    // the best supported variant, unless requested explicitly
+    const dts_variant_t* variant = nullptr;
+    std::string supported;
+    for (const auto& [v, is_supported] : isa_variants()) {
+        if (!is_supported) {
+            continue;
         }
-
-    } else {
-        if (vm.count("command") == 0) {
-            std::cerr << "command is required" << std::endl;
-        } else {
-            std::cerr << "Unknown command" << std::endl;
+        supported += " "s + v->isa;
+        if (isa.empty() || isa == v->isa) {
+            variant = v;
         }
-        std::cerr << visible_opts << std::endl;
+    }
+    if (!variant) {
+        std::cerr << "instruction set variant \"" << isa << "\" is unknown or not supported by CPU, supported:" << supported << std::endl;
+        return 1;
+    }
+    printf("ISA: %s (supported:%s)\n", variant->isa, supported.c_str());
+
+    g_variant = variant;
+    try {
+        variant->run({
+            command,
+            cache_impl,
+            max_depth,
+            Clock::now() + timeout.value,
+            max_width,
+            randomize,
+            cache,
+            lazy,
+            chain_cache,
+            in_place,
+            iterative,
+            cache_mb,
+            verbose,
+            print_cache_hits,
+            print_wins,
+            n_threads,
+            checkpoint,
+            checkpoint_period.value,
+            checkpoint_cache,
+            resume
+        });
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
         return 1;
     }
 
@@ -6,53 +6,66 @@
 
 extern "C" {
 #include "draughts_c.h"
+}
 
 
+// C boards and generator boards have the same absolute orientation:
+// white is side 0, black is side 1.
 
-static board_t to_c_board(const board_state_t& b, bool rotate)
+static board_t to_c_board(const board_state_t& b)
 {
-    if (rotate) {
-        return {
-            reverse(b.sides[1].kings).mask,
-            reverse(b.sides[1].items).mask,
-            reverse(b.sides[0].kings).mask,
-            reverse(b.sides[0].items).mask,
-        };
-    } else {
-        return {
-            b.sides[0].kings.mask,
-            b.sides[0].items.mask,
-            b.sides[1].kings.mask,
-            b.sides[1].items.mask,
-        };
-    }
+    return {
+        b.sides[0].kings.mask,
+        b.sides[0].items.mask,
+        b.sides[1].kings.mask,
+        b.sides[1].items.mask,
+    };
 }
 
-static board_state_t from_c_board(const board_t& b, bool rotate)
+static board_state_t from_c_board(const board_t& b)
 {
-    if (rotate) {
-        return {
-            board_side_t{reverse(b.b_kings), reverse(b.b_items)},
-            board_side_t{reverse(b.w_kings), reverse(b.w_items)}
-        };
-    } else {
-        return {
-            board_side_t{b.w_kings, b.w_items},
-            board_side_t{b.b_kings, b.b_items}
-        };
+    return {
+        board_side_t{b.w_kings, b.w_items},
+        board_side_t{b.b_kings, b.b_items}
+    };
+}
+
+
+template<size_t side_i>
+static int _verify_side_move(const board_state_t& brd, unsigned int from, unsigned int to)
+{
+    moves_generator g;
+
+    // compare moves squares, no need to materialize boards
+    for (const auto& m : g.gen_next_moves<side_i>(brd)) {
+        if (m.src == from && m.dst == to) {
+            return 1;
+        }
     }
+
+    return 0;
 }
 
+template<size_t side_i>
+static board_tree_node_t _generate_side_item_moves(
+    board_t initial_state,
+    unsigned int item_index,
+    int (*verify_move_callback)(board_t, unsigned int, unsigned int)
+);
+
+
+extern "C" {
+
 
 board_t get_initial_board()
 {
-    return to_c_board(initial_board, false);
+    return to_c_board(initial_board);
 }
 
 
 void print_board(board_t b)
 {
-    print(from_c_board(b, false));
+    print(from_c_board(b));
 }
 
 
@@ -170,12 +183,6 @@ static board_tree_node_t to_c_tree_node(const std::pair<board_t, std::vector<boa
 }
 
 
-static brd_index_t from_c_index(unsigned int index, bool rotate)
-{
-    return rotate ? brd_index_t(31 - index) : brd_index_t(index);
-}
-
-
 static int _verify_move(board_t initial_state, unsigned int from, unsigned int to) noexcept
 {
     try {
@@ -183,36 +190,18 @@ static int _verify_move(board_t initial_state, unsigned int from, unsigned int t
             return 0;
         }
 
-        int white_move;
-        uint32_t final_items;
         uint32_t from_mask = 1 << from;
         uint32_t to_mask = 1 << to;
         if (to_mask & initial_state.b_items || to_mask & initial_state.w_items) {
             return 0;
         }
         if (from_mask & initial_state.w_items) {
-            final_items = initial_state.w_items;
-            white_move = 1;
+            return _verify_side_move<0>(from_c_board(initial_state), from, to);
         } else if (from_mask & initial_state.b_items) {
-            final_items = initial_state.b_items;
-            white_move = 0;
+            return _verify_side_move<1>(from_c_board(initial_state), from, to);
         } else {
             return 0;
         }
-        final_items &= ~from_mask;
-        final_items |= to_mask;
-
-        board_states_generator g;
-
-        const auto& v = g.gen_next_states(from_c_board(initial_state, !white_move));
-
-        for (const auto& brd : v) {
-            board_t b = to_c_board(brd, !white_move);
-            if ((white_move && b.w_items == final_items)
-            || (!white_move && b.b_items == final_items)) {
-                return 1;
-            }
-        }
     } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
     }
@@ -227,14 +216,14 @@ int verify_move(board_t initial_state, unsigned int from, unsigned int to)
 }
 
 
-static unsigned int leftmost_bit(uint32_t mask)
+int has_any_legal_move(board_t state, int white_move)
 {
-    for (unsigned int i = 0; i< 32; i++) {
-        if (mask & (1 << i)) {
-            return i;
-        }
+    board_state_t brd = from_c_board(state);
+    if (white_move) {
+        return has_any_legal_move<0>(brd);
+    } else {
+        return has_any_legal_move<1>(brd);
     }
-    return 32;
 }
 
 
@@ -251,51 +240,16 @@ _generate_item_moves(
         return r;
     }
 
-    int white_move;
     uint32_t from_mask = 1 << item_index;
-    if (from_mask & initial_state.w_items) {
-        white_move = 1;
-    } else if (from_mask & initial_state.b_items) {
-        white_move = 0;
-    } else {
-        return r;
-    }
 
     try {
-        board_states_generator g;
-
-        const auto& v = g.gen_item_next_states(from_c_board(initial_state, !white_move), from_c_index(item_index, !white_move));
-
-        if (v.size() == 0) {
-            r.next_states_status = 0;
-            return r;
-        }
-
-        r = new_board_tree_node(initial_state, v.size());
-        if (!r.next_states) {
+        if (from_mask & initial_state.w_items) {
+            return _generate_side_item_moves<0>(initial_state, item_index, verify_move_callback);
+        } else if (from_mask & initial_state.b_items) {
+            return _generate_side_item_moves<1>(initial_state, item_index, verify_move_callback);
+        } else {
             return r;
         }
-
-        r.next_states_status = 0;
-        for (const auto& brd : v) {
-            auto b = to_c_board(brd, !white_move);
-            
-            uint32_t to_mask = white_move ? b.w_items & ~initial_state.w_items : b.b_items & ~initial_state.b_items;
-            if (to_mask == 0){
-                to_mask = from_mask;
-            }
-            unsigned int to_index = leftmost_bit(to_mask);
-            if (to_index >= 32 || !verify_move_callback(initial_state, item_index, to_index)) {
-                continue;
-            }
-
-            r.next_states[r.next_states_status].state = b;
-            r.next_states[r.next_states_status].next_states_status = BOARD_TREE_STATUS_DEPTH;
-            r.next_states[r.next_states_status].next_states = 0;
-            r.next_states_status++;
-        }
-
-        return r;
     } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
 
@@ -331,13 +285,10 @@ _generate_all_moves_lvl(
 
     r.first = initial_state;
 
-    for (unsigned int index = 0; index < 32; index++) {
-        bool white_exist = initial_state.w_items & (1 << index);
-        bool black_exist = initial_state.b_items & (1 << index);
-        if (!(white_move && white_exist) && !(!white_move && black_exist)) {
-            continue;
-        }
-        board_tree_node_t node = generate_item_moves_callback(initial_state, index, verify_move_callback);
+    brd_map_t items = white_move ? initial_state.w_items : initial_state.b_items;
+
+    for (brd_index_t index : items) {
+        board_tree_node_t node = generate_item_moves_callback(initial_state, index.index, verify_move_callback);
         if (node.next_states_status > 0) {
             std::pair<board_t, std::vector<board_t>> items = from_c_tree_node(node);
             r.second.reserve(r.second.size() + items.second.size());
@@ -463,3 +414,39 @@ generate_all_moves(
 } // extern "C"
 
 
+template<size_t side_i>
+static board_tree_node_t _generate_side_item_moves(
+    board_t initial_state,
+    unsigned int item_index,
+    int (*verify_move_callback)(board_t, unsigned int, unsigned int)
+)
+{
+    moves_generator g;
+
+    board_state_t brd = from_c_board(initial_state);
+    const auto& v = g.gen_item_next_moves<side_i>(brd, item_index);
+
+    if (v.size() == 0) {
+        return {initial_state, 0, 0};
+    }
+
+    board_tree_node_t r = new_board_tree_node(initial_state, v.size());
+    if (!r.next_states) {
+        return r;
+    }
+
+    r.next_states_status = 0;
+    for (const auto& m : v) {
+        if (!verify_move_callback(initial_state, item_index, m.dst)) {
+            continue;
+        }
+
+        // only boards of verified moves are materialized
+        r.next_states[r.next_states_status].state = to_c_board(apply<side_i>(brd, m));
+        r.next_states[r.next_states_status].next_states_status = BOARD_TREE_STATUS_DEPTH;
+        r.next_states[r.next_states_status].next_states = 0;
+        r.next_states_status++;
+    }
+
+    return r;
+}
@@ -4,6 +4,13 @@
 #include <array>
 #include <unordered_set>
 #include <iterator>
+#include <random>
+#include <memory>
+#include <sstream>
+#include <algorithm>
+#include <cstdio>
+
+#include <unistd.h>
 
 #include <boost/functional/hash.hpp>
 
@@ -12,6 +19,12 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest/doctest.h"
 #include "draughts_2d.h"
+#include "draughts_batch.h"
+#include "capture_explorer.h"
+#include "bucket_cache.h"
+#include "checkpoint.h"
+#include "perft.h"
+#include "mtdfs.h"
 
 
 // validate 2d board state
@@ -137,6 +150,10 @@ void test_rotation(const board_2d_t& b2)
     auto b22 = from_1d_brd(b13);
     is_valid(b22);
     REQUIRE(b2 == b22);
+
+    // Zobrist key of rotated board is mapped without rehashing
+    REQUIRE(zobrist_key(b12) == rotate_key(zobrist_key(b1)));
+    REQUIRE(rotate(keyed_board_t(b1)).key == zobrist_key(b12));
 }
 
 TEST_CASE("rotation")
@@ -173,6 +190,35 @@ TEST_CASE("rotation")
 }
 
 
+template<size_t dir_i>
+void test_step()
+{
+    for (brd_index_t index = 0; index; ++index) {
+        brd_2d_vector_t dst = brd_2d_vector_t(index) + all_directions[dir_i];
+        brd_map_t expected = dst ? brd_map_t(brd_item_t(dst)) : brd_map_t();
+
+        INFO("direction: " << dir_i << ", index: " << index.index);
+        REQUIRE(step<dir_i>(brd_map_t(brd_item_t(index))) == expected);
+    }
+
+    // whole map steps
+    brd_map_t all = 0xFFFFFFFF;
+    brd_map_t expected;
+    for (brd_index_t index = 0; index; ++index) {
+        expected += step<dir_i>(brd_map_t(brd_item_t(index)));
+    }
+    REQUIRE(step<dir_i>(all) == expected);
+}
+
+TEST_CASE("direction_steps")
+{
+    test_step<0>();
+    test_step<1>();
+    test_step<2>();
+    test_step<3>();
+}
+
+
 void test_generation(const board_2d_t& initial, const std::vector<board_2d_t>& expected)
 {
     is_valid(initial);
@@ -205,6 +251,78 @@ void test_generation(const board_2d_t& initial, const std::vector<board_2d_t>& e
         INFO("board:\n" << from_1d_brd(b));
         REQUIRE(ex_set.count(std::pair<uint64_t, uint64_t>(b)) == 1);
     }
+
+    REQUIRE(has_any_legal_move(s) == !expected.empty());
+
+    // compact moves must produce the same boards
+    moves_generator mg;
+
+    const auto& moves = mg.gen_next_moves(s);
+    REQUIRE(moves.size() == expected.size());
+
+    keyed_board_t ks(s);
+    for (const auto& m : moves) {
+        board_state_t b = apply(s, m);
+        // incrementally updated key must be equal to key of whole board
+        REQUIRE(apply(ks, m).key == zobrist_key(b));
+        if (!m.captured) {
+            REQUIRE(do_move(ks, brd_item_t(brd_index_t(m.src)), brd_item_t(brd_index_t(m.dst))).key == zobrist_key(b));
+        }
+
+        // move made in place and reverted
+        keyed_board_t kb = ks;
+        undo_t u = make_move(kb, m);
+        REQUIRE(kb.state == b);
+        REQUIRE(kb.key == zobrist_key(b));
+        unmake_move(kb, m, u);
+        REQUIRE(kb.state == s);
+        REQUIRE(kb.key == ks.key);
+        INFO("move: " << int(m.src) << " -> " << int(m.dst) << ", promotion: " << m.promotion);
+        INFO("board:\n" << from_1d_brd(b));
+        REQUIRE(ex_set.count(std::pair<uint64_t, uint64_t>(b)) == 1);
+    }
+
+    // counting mode must agree with generation
+    REQUIRE(moves_generator().count_next_moves(s) == expected.size());
+
+    // lazy successors must be the same moves in the same order
+    moves_generator lg;
+    size_t i = 0;
+    for (const auto& m : lazy_moves_t<0>(lg, s)) {
+        REQUIRE(i < moves.size());
+        REQUIRE(apply(s, m) == apply(s, moves[i]));
+        i++;
+    }
+    REQUIRE(i == moves.size());
+
+    // iterative capture sequences explorer must give the same boards
+    if (can_capture(s)) {
+        std::vector<board_state_t> it_states;
+        capture_explorer<0> ig(it_states);
+        ig.prepare(s);
+        ig.gen_captures_iterative();
+        REQUIRE(it_states.size() == expected.size());
+
+        for (const auto& b : it_states) {
+            INFO("board:\n" << from_1d_brd(b));
+            REQUIRE(ex_set.count(std::pair<uint64_t, uint64_t>(b)) == 1);
+        }
+    }
+
+    // batch expansion must give the same boards in the same order
+    std::vector<board_state_t> batch_states;
+    _board_states_generator<0> bg(batch_states);
+    gen_next_states_batch(bg, boards_soa_t({s}), [] (size_t) {});
+    REQUIRE(batch_states == v);
+
+    // the same position rotated with black to move must give rotated boards
+    const auto& bv = g.gen_next_states<1>(rotate(s));
+    REQUIRE(bv.size() == expected.size());
+
+    for (const auto& b : bv) {
+        INFO("board:\n" << from_1d_brd(rotate(b)));
+        REQUIRE(ex_set.count(std::pair<uint64_t, uint64_t>(rotate(b))) == 1);
+    }
 }
 
 void test_cases(const std::vector<std::pair<board_2d_t, std::vector<board_2d_t>>>& cases)
@@ -244,3 +362,586 @@ TEST_CASE("king_multiple_capture")
     test_cases(king_multiple_captures_data);
 }
 
+
+// random positions with given number of items per side, men on king row become kings
+std::vector<board_state_t> random_boards(size_t count, int n_items, double king_p)
+{
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> square(0, 31);
+    std::bernoulli_distribution is_king(king_p);
+
+    std::vector<board_state_t> r;
+    while (r.size() < count) {
+        board_state_t brd{};
+        for (size_t side = 0; side < 2; side++) {
+            for (int n = n_items; n > 0;) {
+                auto item = brd_item_t(brd_index_t(square(rng)));
+                if (brd.occupied().exist(item)) {
+                    continue;
+                }
+                bool king_row = side == 0 ? item.is_on_king_row() : (item.mask & 0xF) != 0;
+                brd.sides[side].items += item;
+                if (king_row || is_king(rng)) {
+                    brd.sides[side].kings += item;
+                }
+                n--;
+            }
+        }
+        r.push_back(brd);
+    }
+    return r;
+}
+
+TEST_CASE("iterative_captures")
+{
+    size_t with_captures = 0;
+    for (int n : {3, 6, 9, 12}) {
+        for (const auto& brd : random_boards(5000, n, 0.3)) {
+            INFO("board:\n" << from_1d_brd(brd));
+            if (can_capture<0>(brd)) {
+                with_captures++;
+                REQUIRE(sorted_captures<0>(brd, true) == sorted_captures<0>(brd, false));
+            }
+            if (can_capture<1>(brd)) {
+                REQUIRE(sorted_captures<1>(brd, true) == sorted_captures<1>(brd, false));
+            }
+        }
+    }
+    REQUIRE(with_captures > 1000);
+}
+
+// results are compared in generation order, which must not depend on cache
+template<size_t side_i>
+std::vector<std::pair<uint64_t, uint64_t>> captures(const board_state_t& brd, chain_cache_t* cache)
+{
+    std::vector<board_state_t> states;
+    _board_states_generator<side_i> g(states);
+    g.chain_cache = cache;
+    g.prepare(brd);
+    g.gen_captures();
+
+    std::vector<std::pair<uint64_t, uint64_t>> r;
+    for (const auto& b : states) {
+        r.push_back(std::pair<uint64_t, uint64_t>(b));
+    }
+    return r;
+}
+
+TEST_CASE("chain_cache")
+{
+    chain_cache_t cache;
+    for (int n : {3, 6, 9, 12}) {
+        for (const auto& brd : random_boards(5000, n, 0.3)) {
+            INFO("board:\n" << from_1d_brd(brd));
+            // the second time results are replayed from cache
+            for (int i = 0; i < 2; i++) {
+                if (can_capture<0>(brd)) {
+                    REQUIRE(captures<0>(brd, &cache) == captures<0>(brd, nullptr));
+                }
+                if (can_capture<1>(brd)) {
+                    REQUIRE(captures<1>(brd, &cache) == captures<1>(brd, nullptr));
+                }
+            }
+        }
+    }
+    REQUIRE(cache.hits > 1000);
+    REQUIRE(cache.hits < cache.lookups);
+}
+
+template<size_t side_i>
+void test_make_unmake(const board_state_t& brd)
+{
+    moves_generator mg;
+    const keyed_board_t kb0(brd);
+    for (const auto& m : mg.gen_next_moves<side_i>(brd)) {
+        keyed_board_t kb = kb0;
+        undo_t u = make_move<side_i>(kb, m);
+        REQUIRE(kb.state == apply<side_i>(brd, m));
+        REQUIRE(kb.key == zobrist_key(kb.state));
+        unmake_move<side_i>(kb, m, u);
+        REQUIRE(kb.state == brd);
+        REQUIRE(kb.key == kb0.key);
+    }
+}
+
+TEST_CASE("make_unmake")
+{
+    for (int n : {3, 6, 9, 12}) {
+        for (const auto& brd : random_boards(5000, n, 0.3)) {
+            INFO("board:\n" << from_1d_brd(brd));
+            test_make_unmake<0>(brd);
+            test_make_unmake<1>(brd);
+        }
+    }
+}
+
+TEST_CASE("any_legal_move")
+{
+    board_states_generator g;
+    size_t terminal = 0;
+    for (int n : {1, 6, 12}) {
+        for (const auto& brd : random_boards(20000, n, 0.1)) {
+            INFO("board:\n" << from_1d_brd(brd));
+            bool white = g.gen_next_states<0>(brd).size() > 0;
+            bool black = g.gen_next_states<1>(brd).size() > 0;
+            REQUIRE(has_any_legal_move<0>(brd) == white);
+            REQUIRE(has_any_legal_move<1>(brd) == black);
+            terminal += !white + !black;
+        }
+    }
+    REQUIRE(terminal > 0);
+}
+
+TEST_CASE("bucket_cache")
+{
+    bucket_cache c;
+    c.resize(1 << 20);
+    REQUIRE(c.capacity() == (1 << 20) / 16);
+
+    // boards with keys of the same bucket
+    auto brd = [] (uint64_t i) { return std::pair<uint64_t, uint64_t>(i, ~i); };
+    auto key = [] (uint64_t i) { return i << 32; };
+
+    for (uint16_t i = 0; i < 4; i++) {
+        auto [depth, inserted] = c.insert(brd(i), key(i));
+        REQUIRE(inserted);
+        *depth = 10 + i;
+    }
+    auto [depth, inserted] = c.insert(brd(2), key(2));
+    REQUIRE(!inserted);
+    REQUIRE(*depth == 12);
+    // the same key, other board
+    REQUIRE(c.insert(brd(5), key(2)).second);
+    REQUIRE(c.replaced() == 1);
+
+    // the least deep entry is replaced
+    REQUIRE(c.insert(brd(0), key(0)).second);
+    REQUIRE(!c.insert(brd(3), key(3)).second);
+
+    // entries of previous generation are replaced first
+    c.new_generation();
+    REQUIRE(!c.insert(brd(3), key(3)).second);
+    for (uint64_t i = 10; i < 13; i++) {
+        REQUIRE(c.insert(brd(i), key(i)).second);
+    }
+    REQUIRE(!c.insert(brd(3), key(3)).second);
+    REQUIRE(c.size() == 4);
+}
+
+TEST_CASE("checkpoint")
+{
+    const std::string path = "test_checkpoint.bin";
+
+    bucket_cache c;
+    c.resize(1 << 12);
+    for (uint64_t i = 0; i < 100; i++) {
+        *c.insert({i, ~i}, i * 0x9E3779B97F4A7C15ull).first = i;
+    }
+
+    {
+        checkpoint_writer w(path);
+        w.put(size_t(42));
+        w.put_vector(std::vector<uint32_t>{1, 2, 3});
+        w.put_string("dfs");
+        c.save(w);
+        w.commit();
+    }
+
+    {
+        checkpoint_reader r(path);
+        REQUIRE(r.get<size_t>() == 42);
+        REQUIRE(r.get_vector<uint32_t>() == std::vector<uint32_t>({1, 2, 3}));
+        REQUIRE(r.get_string() == "dfs");
+        bucket_cache loaded;
+        loaded.resize(1 << 12);
+        loaded.load(r);
+        REQUIRE(loaded.size() == c.size());
+        for (uint64_t i = 0; i < 100; i++) {
+            auto [depth, inserted] = loaded.insert({i, ~i}, i * 0x9E3779B97F4A7C15ull);
+            REQUIRE(!inserted);
+            REQUIRE(*depth == i);
+        }
+        // nothing after the table
+        REQUIRE_THROWS_AS(r.get<uint8_t>(), checkpoint_error);
+    }
+
+    {
+        // table of other size
+        checkpoint_reader r(path);
+        r.get<size_t>();
+        r.get_vector<uint32_t>();
+        r.get_string();
+        bucket_cache other;
+        other.resize(1 << 13);
+        REQUIRE_THROWS_AS(other.load(r), checkpoint_error);
+    }
+
+    {
+        // not committed checkpoint doesn't replace the old one
+        checkpoint_writer w(path);
+        w.put(size_t(0));
+    }
+    REQUIRE(checkpoint_reader(path).get<size_t>() == 42);
+
+    {
+        checkpoint_writer w(path);
+        w.commit();
+    }
+    REQUIRE_THROWS_AS(checkpoint_reader(path).get<size_t>(), checkpoint_error);
+
+    {
+        // stats, including counters of chain cache, which itself is not saved
+        stats s;
+        s.consume_level_width(3, 0);
+        s.consume_level_width(0, 1);
+        s.depth_limit(2);
+        chain_cache_t cc;
+        cc.lookups = 5;
+        cc.hits = 3;
+        s.chain_cache_usage(cc);
+
+        checkpoint_writer w(path);
+        s.save(w);
+        w.commit();
+
+        checkpoint_reader r(path);
+        stats loaded;
+        loaded.load(r);
+        REQUIRE(loaded == s);
+
+        chain_cache_t resumed;
+        loaded.restore_chain_cache_usage(resumed);
+        REQUIRE(resumed.lookups == 5);
+        REQUIRE(resumed.hits == 3);
+    }
+
+    FILE* f = fopen(path.c_str(), "wb");
+    fputs("DTS", f);
+    fclose(f);
+    REQUIRE_THROWS_AS(checkpoint_reader{path}, checkpoint_error);
+
+    remove(path.c_str());
+}
+
+TEST_CASE("perft")
+{
+    // total boards and boards at depth limit from initial board, counted by plain DFS without cache
+    const std::vector<std::pair<size_t, size_t>> expected = {
+        {7, 7},
+        {56, 49},
+        {358, 302},
+        {1827, 1469},
+        {9309, 7482},
+        {47295, 37986},
+        {237441, 190146},
+        {1167337, 929896},
+        {5737871, 4570534},
+        {28175386, 22437515},
+        {139021702, 110846316},
+    };
+
+    // no memoization, memo much smaller than the tree - with replacements, memo large enough
+    for (size_t cache_bytes : {size_t(0), size_t(1) << 20, size_t(64) << 20}) {
+        for (size_t depth = 1; depth <= expected.size(); depth++) {
+            INFO("depth: " << depth << ", memo bytes: " << cache_bytes);
+            PERFT x(depth, Clock::now() + 1h, cache_bytes);
+            perft_t r = x.count(initial_board);
+            REQUIRE(x.running());
+            REQUIRE(r.nodes == expected[depth - 1].first);
+            REQUIRE(r.depth_limits == expected[depth - 1].second);
+            REQUIRE(r.w_wins == 0);
+            REQUIRE(r.b_wins == 0);
+        }
+    }
+}
+
+using boards_set_t = std::unordered_set<std::pair<uint64_t, uint64_t>, boost::hash<std::pair<uint64_t, uint64_t>>>;
+
+// Every board generated by search: all successors of expanded board are passed to callback.
+// Board and its rotation are the same cache entry (the same position of other side to move),
+// so only one of them is kept.
+template<class Cache>
+boards_set_t reachable_boards(size_t max_depth, bool cache, size_t cache_mb, size_t& reexpanded)
+{
+    search_config_t cfg{max_depth, Clock::now() + 1h};
+    cfg.cache = cache;
+    cfg.cache_mb = cache_mb;
+
+    boards_set_t boards;
+    DFS<Cache> x(cfg, false, false, false, [&] (const board_state_t& brd, size_t) {
+        boards.insert(std::min(std::pair<uint64_t, uint64_t>(brd), std::pair<uint64_t, uint64_t>(rotate(brd))));
+        return true;
+    });
+    auto [sts, completed] = x._do_search(initial_board);
+    REQUIRE(completed);
+
+    reexpanded = sts.reexpanded();
+    return boards;
+}
+
+TEST_CASE("dfs_cache")
+{
+    // boards are visited again with more remaining depth since depth 6
+    for (size_t depth : {6, 7, 8}) {
+        INFO("depth: " << depth);
+        size_t reexpanded = 0;
+        boards_set_t expected = reachable_boards<judy_cache>(depth, false, 0, reexpanded);
+
+        // Board stored with less remaining depth than it has now is expanded again,
+        // otherwise boards under it would be missed. Replaced entries of bucket cache are just expanded again.
+        REQUIRE(reachable_boards<std_cache>(depth, true, 0, reexpanded) == expected);
+        REQUIRE(reexpanded > 0);
+        REQUIRE(reachable_boards<dense_cache>(depth, true, 0, reexpanded) == expected);
+        REQUIRE(reexpanded > 0);
+        REQUIRE(reachable_boards<judy_cache>(depth, true, 0, reexpanded) == expected);
+        REQUIRE(reexpanded > 0);
+        REQUIRE(reachable_boards<bounded_cache>(depth, true, 1, reexpanded) == expected);
+        REQUIRE(reexpanded > 0);
+        REQUIRE(reachable_boards<bounded_cache>(depth, true, 64, reexpanded) == expected);
+        REQUIRE(reexpanded > 0);
+    }
+}
+
+// everything printed by f() into stdout
+template<class F>
+std::string capture_stdout(F&& f)
+{
+    fflush(stdout);
+    FILE* tmp = tmpfile();
+    int saved = dup(STDOUT_FILENO);
+    dup2(fileno(tmp), STDOUT_FILENO);
+
+    f();
+
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+
+    std::string r;
+    rewind(tmp);
+    char buf[4096];
+    for (size_t n; (n = fread(buf, 1, sizeof(buf), tmp)) > 0; ) {
+        r.append(buf, n);
+    }
+    fclose(tmp);
+    return r;
+}
+
+struct dfs_run_t
+{
+    stats sts;
+    bool completed;
+    // output of verbose and win paths
+    std::string out;
+    // boards passed to callback in order of generation
+    std::vector<std::pair<board_state_t, size_t>> generated;
+};
+
+dfs_run_t run_dfs(const board_state_t& root, const search_config_t& cfg, bool print, bool record)
+{
+    dfs_run_t r;
+    brd_callback_t callback = nullptr;
+    if (record) {
+        callback = [&r] (const board_state_t& brd, size_t depth) {
+            r.generated.push_back({brd, depth});
+            return true;
+        };
+    }
+
+    DFS<judy_cache> x(cfg, print, print, false, callback);
+    r.out = capture_stdout([&] {
+        std::tie(r.sts, r.completed) = x.do_search(std::vector<board_state_t>{root}, 0);
+    });
+    return r;
+}
+
+TEST_CASE("dfs_iterative")
+{
+    // both sides win within 6 moves
+    const board_state_t root = {board_side_t{0, 0x00000F00}, board_side_t{0, 0x00F00000}};
+    const size_t depth = 6;
+
+    for (bool cache : {false, true}) {
+        INFO("cache: " << cache);
+        search_config_t cfg{depth, Clock::now() + 1h};
+        cfg.cache = cache;
+
+        // printing boards and win paths, callback, and only counting with bulk counted leaves
+        for (auto [print, record] : {std::pair(true, false), std::pair(false, true), std::pair(false, false)}) {
+            INFO("print: " << print << ", record: " << record);
+            dfs_run_t expected = run_dfs(root, cfg, print, record);
+            REQUIRE(expected.completed);
+            if (print) {
+                REQUIRE(expected.out.find("W WINS!") != std::string::npos);
+                REQUIRE(expected.out.find("B WINS!") != std::string::npos);
+            }
+
+            search_config_t icfg = cfg;
+            icfg.iterative = true;
+            dfs_run_t r = run_dfs(root, icfg, print, record);
+            REQUIRE(r.completed);
+            REQUIRE(r.sts == expected.sts);
+            // not decomposed, output is large
+            REQUIRE((r.out == expected.out));
+            REQUIRE(r.generated == expected.generated);
+
+            // win path of in-place search is replayed from moves
+            search_config_t pcfg = cfg;
+            pcfg.in_place = true;
+            r = run_dfs(root, pcfg, print, record);
+            REQUIRE(r.completed);
+            REQUIRE(r.sts == expected.sts);
+            REQUIRE((r.out == expected.out));
+            REQUIRE(r.generated == expected.generated);
+        }
+    }
+}
+
+TEST_CASE("dfs_checkpoint")
+{
+    const std::string path = "test_dfs_checkpoint.bin";
+
+    // roots: all boards after 2 moves, white to move
+    std::vector<board_state_t> roots;
+    {
+        search_config_t cfg{2, Clock::now() + 1h};
+        DFS<judy_cache> x(cfg, false, false, false, [&] (const board_state_t& brd, size_t depth) {
+            if (depth == 2) {
+                roots.push_back(brd);
+            }
+            return true;
+        });
+        x._do_search(initial_board);
+    }
+    REQUIRE(roots.size() == 49);
+
+    // with max depth 1 roots are completed without entering frames below them
+    for (size_t max_depth : {1, 2}) {
+        INFO("max depth: " << max_depth);
+        search_config_t cfg{max_depth, Clock::now() + 1h};
+        cfg.iterative = true;
+
+        // status is handled after every board (as with printing of cache hits, which are none without cache),
+        // leaves are still bulk counted
+        auto new_dfs = [&cfg] {
+            return std::make_unique<DFS<judy_cache>>(cfg, false, false, true);
+        };
+
+        dfs_run_t expected;
+        auto uninterrupted = new_dfs();
+        uninterrupted->set_roots(roots, 0);
+        capture_stdout([&] {
+            std::tie(expected.sts, expected.completed) = uninterrupted->continue_search();
+        });
+        REQUIRE(expected.completed);
+
+        // checkpoint is due after every board, every few of them is written and resumed to the end
+        size_t checkpoints = 0;
+        std::vector<Clock::duration> elapsed;
+        std::vector<dfs_run_t> resumed;
+        auto x = new_dfs();
+        x->set_checkpoint([&] {
+            if (checkpoints++ % 7 != 0) {
+                return;
+            }
+            {
+                checkpoint_writer w(path);
+                x->save(w);
+                w.commit();
+            }
+            {
+                checkpoint_reader r(path);
+                r.get<uint32_t>(); // seed
+                elapsed.push_back(r.get<Clock::duration>());
+            }
+
+            checkpoint_reader r(path);
+            auto y = new_dfs();
+            y->load(r);
+            dfs_run_t& run = resumed.emplace_back();
+            std::tie(run.sts, run.completed) = y->continue_search();
+        }, Clock::duration(0));
+
+        dfs_run_t interrupted;
+        x->set_roots(roots, 0);
+        capture_stdout([&] {
+            std::tie(interrupted.sts, interrupted.completed) = x->continue_search();
+        });
+
+        REQUIRE(interrupted.completed);
+        REQUIRE(interrupted.sts.total_boards() == expected.sts.total_boards());
+        REQUIRE(interrupted.sts == expected.sts);
+
+        // checkpoints were written in the middle of search
+        REQUIRE(resumed.size() > 1);
+        REQUIRE(checkpoints > resumed.size());
+        for (const auto& e : elapsed) {
+            REQUIRE(e >= Clock::duration(0));
+            REQUIRE(e < 1h);
+        }
+        for (const auto& run : resumed) {
+            REQUIRE(run.completed);
+            REQUIRE(run.sts.total_boards() == expected.sts.total_boards());
+            REQUIRE(run.sts == expected.sts);
+        }
+    }
+
+    remove(path.c_str());
+}
+
+// printed stats without time and rates
+std::string search_summary(const std::string& out)
+{
+    std::istringstream in(out);
+    std::string r;
+    for (std::string line; std::getline(in, line); ) {
+        if (line.rfind("elapsed", 0) != 0 && line.rfind("rate", 0) != 0) {
+            r += line + "\n";
+        }
+    }
+    return r;
+}
+
+TEST_CASE("mtdfs_checkpoint")
+{
+    // status of workers is handled every million of boards
+    search_config_t cfg{9, Clock::now() + 1h};
+    cfg.iterative = true;
+    const size_t n_threads = 2;
+
+    std::string expected = search_summary(capture_stdout([&] {
+        MTDFS<DFS<judy_cache, false>> x(n_threads, cfg);
+        x.do_search(initial_board);
+    }));
+    REQUIRE(expected.find("total boards: 5737871\n") != std::string::npos);
+
+    // checkpoint is due at every status check of every worker
+    std::vector<std::string> paths;
+    MTDFS<DFS<judy_cache, false>> x(n_threads, cfg);
+    x.set_checkpoint([&] {
+        paths.push_back("test_mtdfs_checkpoint_" + std::to_string(paths.size()) + ".bin");
+        checkpoint_writer w(paths.back());
+        x.save(w);
+        w.commit();
+    }, Clock::duration(0));
+    std::string interrupted = search_summary(capture_stdout([&] {
+        x.do_search(initial_board);
+    }));
+
+    REQUIRE((interrupted == expected));
+    // initial boards of workers and search in the middle
+    REQUIRE(paths.size() > 2);
+
+    for (const auto& path : paths) {
+        INFO("checkpoint: " << path);
+        MTDFS<DFS<judy_cache, false>> y(n_threads, cfg);
+        checkpoint_reader r(path);
+        y.load(r);
+        std::string resumed = search_summary(capture_stdout([&] {
+            y.resume();
+        }));
+        // initial BFS is not repeated
+        REQUIRE((resumed.substr(resumed.find("Completed!")) == expected.substr(expected.find("Completed!"))));
+        remove(path.c_str());
+    }
+}
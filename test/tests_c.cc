@@ -155,5 +155,18 @@ TEST_CASE("validation")
 }
 
 
-
-
+TEST_CASE("any_legal_move")
+{
+    board_t initial = get_initial_board();
+    REQUIRE_EQ(has_any_legal_move(initial, 1), 1);
+    REQUIRE_EQ(has_any_legal_move(initial, 0), 1);
+
+    board_t empty{0, 0, 0, 0};
+    REQUIRE_EQ(has_any_legal_move(empty, 1), 0);
+    REQUIRE_EQ(has_any_legal_move(empty, 0), 0);
+
+    // white item on a1 is blocked by black items on b2 and c3, black items can move
+    board_t blocked{0, 1u << 0, 0, (1u << 4) | (1u << 9)};
+    REQUIRE_EQ(has_any_legal_move(blocked, 1), 0);
+    REQUIRE_EQ(has_any_legal_move(blocked, 0), 1);
+}